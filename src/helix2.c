@@ -46,80 +46,724 @@
  * SOFTWARE.
  */
 
-#include "helix2.h"
+#define _HELIX2_EXPORT     // before helix2.h, so HELIX2_API exports from a shared library build
+#include "helix2_internal.h"
+#include <stdatomic.h>
 
-#define _HELIX2_EXPORT
+#if defined(HELIX2_ARCH_X86) && (defined(__GNUC__) || defined(__clang__))
+    #include <cpuid.h>
+#endif
+#if defined(HELIX2_ARCH_ARM) && !defined(__aarch64__) && defined(__linux__)
+    #include <sys/auxv.h>
+    #include <asm/hwcap.h>
+#endif
+
+// One queued block of a batch message, the keystream bytes [block_offset, block_offset + size) go to data
+//   stream, if set, receives the whole keystream block (the last block of a context message).
+typedef struct {
+    uint8_t *data;
+    size_t block_offset;
+    size_t size;
+    uint32_t *stream;
+} _helix2_lane_t;
+
+// Blocks of short messages waiting for a full set of SIMD lanes, each with its own block state
+typedef struct {
+    _Alignas(64) uint32_t states[HELIX2_MAX_BLOCKS * 16];
+    _Alignas(64) uint32_t keystream[HELIX2_MAX_BLOCKS * 16];
+    _helix2_lane_t lanes[HELIX2_MAX_BLOCKS];
+    size_t queued;
+} _helix2_lane_queue_t;
+
+_Static_assert(sizeof(helix2_session_t) == HELIX2_CACHE_LINE, "a session is one cache line");
+
+// Keystream engines built into the library, ordered from narrowest to widest
+static const _helix2_engine_t _helix2_engines[] = {
+    { HELIX2_BACKEND_SCALAR, 1,                    _helix2_keystream_scalar, _helix2_lanes_scalar },
+#if defined(HELIX2_ARCH_X86)
+    { HELIX2_BACKEND_SSE2,   HELIX2_SSE2_BLOCKS,   _helix2_keystream_sse2,   _helix2_lanes_sse2 },
+    { HELIX2_BACKEND_AVX2,   HELIX2_AVX2_BLOCKS,   _helix2_keystream_avx2,   _helix2_lanes_avx2 },
+    { HELIX2_BACKEND_AVX512, HELIX2_AVX512_BLOCKS, _helix2_keystream_avx512, _helix2_lanes_avx512 },
+#elif defined(HELIX2_ARCH_ARM)
+    { HELIX2_BACKEND_NEON,   HELIX2_NEON_BLOCKS,   _helix2_keystream_neon,   _helix2_lanes_neon },
+#endif
+};
+#define _HELIX2_ENGINE_COUNT (sizeof(_helix2_engines) / sizeof(_helix2_engines[0]))
+
+// Selected engine (NULL until first use, or after helix2_set_backend(HELIX2_BACKEND_AUTO)) and the engines usable
+// next to it (bit i for _helix2_engines[i], 0 until detected)
+//   Both are atomic, so helix2_set_backend may run while other threads encrypt: each call then uses either the old
+//   or the new engine, and both produce the same keystream.
+static _Atomic(const _helix2_engine_t *) _helix2_engine = NULL;
+static _Atomic unsigned int _helix2_engine_usable = 0;
 
 // Internal helper function declarations
-void _helix2_initialize_keystream(helix2_context_t* context, uint64_t block_index);
-static inline void _helix2_shuffle(uint32_t *state, uint8_t a, uint8_t b, uint8_t c, uint8_t d);
-static inline uint32_t _rotl32(uint32_t x, int n);
 static inline uint32_t _pack4(const uint8_t *a);
+static inline void _helix2_block(const uint32_t *state, uint32_t *stream);
+static inline void _helix2_set_block_index(uint32_t *state, uint32_t nonce_word, uint64_t block_index);
+static void _helix2_pack_state(uint32_t *state, const uint8_t *key, const uint8_t *nonce);
+static void _helix2_pack_nonce(uint32_t *state, const uint8_t *nonce);
+static void _helix2_pack_rows(const uint32_t *state, uint32_t *rows);
+static void _helix2_pack_nonce_row(const uint32_t *state, uint32_t *rows);
+static int _helix2_keystream_output(size_t size);
+static void _helix2_queue_blocks(_helix2_lane_queue_t *queue, const uint32_t *state, uint32_t nonce_word, uint8_t *data, size_t size, uint64_t start_offset, uint32_t *stream);
+static void _helix2_flush_lanes(_helix2_lane_queue_t *queue);
+static bool _helix2_queue_pending(const _helix2_lane_queue_t *queue, const uint32_t *stream);
+static uint64_t _helix2_process_iov(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, const helix2_iovec_t *iov, size_t iov_count, uint64_t start_offset, uint32_t *stream);
+static inline void _helix2_output(uint8_t *dst, const uint8_t *src, const uint8_t *keystream, size_t size, int output);
+static uint64_t _helix2_process(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint8_t *dst, const uint8_t *src, size_t size, uint64_t start_offset, uint32_t *stream, int output);
+static bool _helix2_cpu_supports(helix2_backend_t backend);
+static const _helix2_engine_t *_helix2_find_engine(helix2_backend_t backend);
+static unsigned int _helix2_usable_engines(void);
 
 // Exposed functions
 // Initialize the Helix2 context with key and nonce
 HELIX2_API void helix2_initialize_context(helix2_context_t* context, const uint8_t* key, uint8_t* nonce) {
-    // Prepare the context
+    // Pick the keystream engine for this CPU before the first buffer is processed
+    _helix2_get_engine();
+
+    // Prepare the context, the key and nonce are not kept beyond their packed words
     memset(context, 0, sizeof(helix2_context_t));
-    memcpy(context->key, key, sizeof(context->key));            // copy 32 x 8-bit key
-    memcpy(context->nonce, nonce, sizeof(context->nonce));      // copy 20 x 8-bit nonce
 
-    const uint8_t *magic_constant = (uint8_t*)"so!M4g1c";       // every little code needs some magic
-    context->state[0] = _pack4(&magic_constant[0]);   // use pack4 to convert 8 bytes to 2 uint32_t
-    context->state[1] = _pack4(&magic_constant[4]);   
+    _helix2_pack_state(context->state, key, nonce);
+    _helix2_pack_rows(context->state, context->rows);
+    context->nonce_word = context->state[11];
+}
 
-    // Pack key using _pack4 (since key comes as bytes)
-    context->state[2] = _pack4(&context->key[0]);
-    context->state[3] = _pack4(&context->key[4]);
-    context->state[4] = _pack4(&context->key[8]);
-    context->state[5] = _pack4(&context->key[12]);
-    context->state[6] = _pack4(&context->key[16]);
-    context->state[7] = _pack4(&context->key[20]);
-    context->state[8] = _pack4(&context->key[24]);
-    context->state[9] = _pack4(&context->key[28]);
-
-	context->state[10] = 0;                           // This will hold the block index, assigned later
-    
-    // Pack nonce using _pack4 (since nonce comes as bytes)
-	context->state[11] = _pack4(&context->nonce[0]);  // The high bits of the block index, will be XORed here later
-	context->state[12] = _pack4(&context->nonce[4]);
-	context->state[13] = _pack4(&context->nonce[8]);    
-    context->state[14] = _pack4(&context->nonce[12]);    
-    context->state[15] = _pack4(&context->nonce[16]);
+// Switch a context to another nonce under the same key, only the nonce words of the state are packed again
+//   The context then produces the same keystream as a fresh helix2_initialize_context with this nonce.
+HELIX2_API void helix2_set_nonce(helix2_context_t* context, const uint8_t* nonce) {
+    _helix2_pack_nonce(context->state, nonce);
+    _helix2_pack_nonce_row(context->state, context->rows);
+    context->nonce_word = context->state[11];
+}
+
+// Initialize a read-only key schedule with key and nonce
+//   The schedule is never written by helix2_key_buffer, so one schedule can be shared by any number of threads.
+HELIX2_API void helix2_initialize_key(helix2_key_t* schedule, const uint8_t* key, const uint8_t* nonce) {
+    // Pick the keystream engine for this CPU before the first buffer is processed
+    _helix2_get_engine();
+
+    _helix2_pack_state(schedule->state, key, nonce);
+    _helix2_pack_rows(schedule->state, schedule->rows);
+}
+
+// Switch a key schedule to another nonce under the same key
+//   Not thread-safe, the schedule must not be in use by other threads while its nonce changes.
+HELIX2_API void helix2_key_set_nonce(helix2_key_t* schedule, const uint8_t* nonce) {
+    _helix2_pack_nonce(schedule->state, nonce);
+    _helix2_pack_nonce_row(schedule->state, schedule->rows);
 }
 
 // Encrypt/Decrypt a buffer starting from a given offset
 //   The buffer offset always starts at offset 0 within the provided buffer.
 //   The start_offset is the offset in the keystream where the buffer processing should begins.
 HELIX2_API void helix2_buffer(helix2_context_t* context, uint8_t* buffer, size_t size, uint64_t start_offset) {
+    uint32_t nonce_word = context->nonce_word;
+    uint64_t last_block = _helix2_process(context->state, context->rows, nonce_word, buffer, buffer, size, start_offset, context->stream, _HELIX2_OUTPUT_XOR);
+
+    // Leave the block index of the last keystream block in the state, like _helix2_initialize_keystream
+    _helix2_set_block_index(context->state, nonce_word, last_block);
+}
+
+// Switch to another nonce and encrypt/decrypt a buffer under it, helix2_set_nonce followed by helix2_buffer
+HELIX2_API void helix2_buffer_nonce(helix2_context_t* context, const uint8_t* nonce, uint8_t* buffer, size_t size, uint64_t start_offset) {
+    helix2_set_nonce(context, nonce);
+    helix2_buffer(context, buffer, size, start_offset);
+}
+
+// Encrypt/Decrypt out of place, dst = src ^ keystream in one pass
+//   dst may equal src (same as helix2_buffer), other overlaps are not supported.
+HELIX2_API void helix2_buffer_copy(helix2_context_t* context, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset) {
+    uint32_t nonce_word = context->nonce_word;
+    uint64_t last_block = _helix2_process(context->state, context->rows, nonce_word, dst, src, size, start_offset, context->stream, _HELIX2_OUTPUT_XOR);
+
+    _helix2_set_block_index(context->state, nonce_word, last_block);
+}
+
+// Encrypt/Decrypt a list of segments as one logical stream starting at start_offset
+//   Keystream left over at the end of a segment is used for the next one, so partial blocks are never rebuilt.
+HELIX2_API void helix2_buffer_iov(helix2_context_t* context, const helix2_iovec_t* iov, size_t iov_count, uint64_t start_offset) {
+    uint32_t nonce_word = context->nonce_word;
+    uint64_t last_block = _helix2_process_iov(context->state, context->rows, nonce_word, iov, iov_count, start_offset, context->stream);
+
+    _helix2_set_block_index(context->state, nonce_word, last_block);
+}
+
+// Encrypt/Decrypt a buffer with a shared key schedule, same stream as helix2_buffer for the same key and nonce
+//   All scratch lives on the stack, the schedule is only read, so concurrent calls on one schedule are safe.
+HELIX2_API void helix2_key_buffer(const helix2_key_t* schedule, uint8_t* buffer, size_t size, uint64_t start_offset) {
+    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    _helix2_process(schedule->state, schedule->rows, schedule->state[11], buffer, buffer, size, start_offset, stream, _HELIX2_OUTPUT_XOR);
+}
+
+// Encrypt/Decrypt out of place with a shared key schedule, thread-safe like helix2_key_buffer
+HELIX2_API void helix2_key_buffer_copy(const helix2_key_t* schedule, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset) {
+    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    _helix2_process(schedule->state, schedule->rows, schedule->state[11], dst, src, size, start_offset, stream, _HELIX2_OUTPUT_XOR);
+}
+
+// Encrypt/Decrypt a list of segments with a shared key schedule, thread-safe like helix2_key_buffer
+HELIX2_API void helix2_key_buffer_iov(const helix2_key_t* schedule, const helix2_iovec_t* iov, size_t iov_count, uint64_t start_offset) {
+    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    _helix2_process_iov(schedule->state, schedule->rows, schedule->state[11], iov, iov_count, start_offset, stream);
+}
+
+// Write raw keystream to out, the same bytes helix2_buffer would XOR into the buffer
+//   Large outputs use non-temporal stores where the CPU has them, so the keystream does not evict the cache.
+HELIX2_API void helix2_keystream(helix2_context_t* context, uint8_t* out, size_t size, uint64_t start_offset) {
+    uint32_t nonce_word = context->nonce_word;
+    uint64_t last_block = _helix2_process(context->state, context->rows, nonce_word, out, out, size, start_offset, context->stream, _helix2_keystream_output(size));
+
+    _helix2_set_block_index(context->state, nonce_word, last_block);
+}
+
+// Write raw keystream to out from a shared key schedule, thread-safe like helix2_key_buffer
+HELIX2_API void helix2_key_keystream(const helix2_key_t* schedule, uint8_t* out, size_t size, uint64_t start_offset) {
+    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    _helix2_process(schedule->state, schedule->rows, schedule->state[11], out, out, size, start_offset, stream, _helix2_keystream_output(size));
+}
+
+
+// Encrypt/decrypt a batch of messages, each under its own nonce
+//   Short messages are cut into blocks that are queued as independent lane states and run through the lanes engines
+//   HELIX2_MAX_BLOCKS at a time, long ones go through the regular multi-block path.
+HELIX2_API void helix2_key_buffer_batch(const helix2_key_t* schedule, const helix2_message_t* messages, size_t count) {
+    _helix2_lane_queue_t queue;
+    uint32_t state[16];
+
+    queue.queued = 0;
+    memcpy(state, schedule->state, sizeof(state));
+
+    for (size_t m = 0; m < count; m++) {
+        const helix2_message_t *message = &messages[m];
+        if (message->size == 0) continue;
+
+        _helix2_pack_nonce(state, message->nonce);
+        uint32_t nonce_word = state[11];
+
+        if (message->size >= HELIX2_BATCH_DIRECT_MIN) {
+            uint32_t rows[16], stream[16];
+            memcpy(rows, schedule->rows, sizeof(rows));
+            _helix2_pack_nonce_row(state, rows);
+            _helix2_process(state, rows, nonce_word, message->buffer, message->buffer, message->size, message->start_offset, stream, _HELIX2_OUTPUT_XOR);
+            continue;
+        }
+
+        _HELIX2_STATS_CALL(message->size);
+        _helix2_queue_blocks(&queue, state, nonce_word, message->buffer, message->size, message->start_offset, NULL);
+    }
+
+    if (queue.queued > 0) _helix2_flush_lanes(&queue);
+}
+
+// Encrypt/decrypt a batch of messages under different key schedules, the blocks of all messages share the SIMD lanes
+//   Each lane gets the whole state of its message's schedule, so any mix of keys and nonces fills the vectors.
+HELIX2_API void helix2_key_buffer_multi(const helix2_key_message_t* messages, size_t count) {
+    _helix2_lane_queue_t queue;
+    queue.queued = 0;
+
+    for (size_t m = 0; m < count; m++) {
+        const helix2_key_message_t *message = &messages[m];
+        const helix2_key_t *schedule = message->schedule;
+        if (message->size == 0) continue;
+
+        if (message->size >= HELIX2_BATCH_DIRECT_MIN) {
+            uint32_t stream[16];
+            _helix2_process(schedule->state, schedule->rows, schedule->state[11], message->buffer, message->buffer, message->size, message->start_offset, stream, _HELIX2_OUTPUT_XOR);
+            continue;
+        }
+
+        _HELIX2_STATS_CALL(message->size);
+        _helix2_queue_blocks(&queue, schedule->state, schedule->state[11], message->buffer, message->size, message->start_offset, NULL);
+    }
+
+    if (queue.queued > 0) _helix2_flush_lanes(&queue);
+}
+
+// Encrypt/decrypt a batch of messages, each with its own context, same output and context state as helix2_buffer
+//   called on every message in order.
+HELIX2_API void helix2_buffer_multi(const helix2_context_message_t* messages, size_t count) {
+    _helix2_lane_queue_t queue;
+    queue.queued = 0;
+
+    for (size_t m = 0; m < count; m++) {
+        const helix2_context_message_t *message = &messages[m];
+        helix2_context_t *context = message->context;
+        uint32_t nonce_word = context->nonce_word;
+
+        // Long messages, and empty ones (helix2_buffer still moves the context to their block)
+        uint64_t last_block;
+        if (message->size == 0 || message->size >= HELIX2_BATCH_DIRECT_MIN) {
+            // A queued block of the same context would overwrite its stream later, out of order
+            if (_helix2_queue_pending(&queue, context->stream)) _helix2_flush_lanes(&queue);
+            last_block = _helix2_process(context->state, context->rows, nonce_word, message->buffer, message->buffer, message->size, message->start_offset, context->stream, _HELIX2_OUTPUT_XOR);
+        } else {
+            _HELIX2_STATS_CALL(message->size);
+            _helix2_queue_blocks(&queue, context->state, nonce_word, message->buffer, message->size, message->start_offset, context->stream);
+            last_block = (message->start_offset + message->size - 1) / HELIX2_KEYSTREAM_SIZE;
+        }
+        _helix2_set_block_index(context->state, nonce_word, last_block);
+    }
+
+    if (queue.queued > 0) _helix2_flush_lanes(&queue);
+}
+
+
+// Initialize a compact session with key and nonce
+HELIX2_API void helix2_session_init(helix2_session_t* session, const uint8_t* key, const uint8_t* nonce) {
+    _helix2_get_engine();
+    _helix2_pack_state(session->state, key, nonce);
+}
+
+// Switch a session to another nonce under the same key
+HELIX2_API void helix2_session_set_nonce(helix2_session_t* session, const uint8_t* nonce) {
+    _helix2_pack_nonce(session->state, nonce);
+}
+
+// Expand a session into a full key schedule, for a session that is about to process many buffers
+HELIX2_API void helix2_session_key(const helix2_session_t* session, helix2_key_t* schedule) {
+    memcpy(schedule->state, session->state, sizeof(schedule->state));
+    _helix2_pack_rows(schedule->state, schedule->rows);
+}
+
+// Encrypt/Decrypt a buffer with a session, thread-safe like helix2_key_buffer
+//   The round 1 rows are rebuilt per call (three shuffles, less than a fifth of one block).
+HELIX2_API void helix2_session_buffer(const helix2_session_t* session, uint8_t* buffer, size_t size, uint64_t start_offset) {
+    uint32_t rows[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    _helix2_pack_rows(session->state, rows);
+    _helix2_process(session->state, rows, session->state[11], buffer, buffer, size, start_offset, stream, _HELIX2_OUTPUT_XOR);
+}
+
+// Encrypt/Decrypt out of place with a session, thread-safe like helix2_key_buffer
+HELIX2_API void helix2_session_buffer_copy(const helix2_session_t* session, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset) {
+    uint32_t rows[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    _helix2_pack_rows(session->state, rows);
+    _helix2_process(session->state, rows, session->state[11], dst, src, size, start_offset, stream, _HELIX2_OUTPUT_XOR);
+}
+
+
+// Initialize a stream at a keystream offset, for sequential updates of any size
+HELIX2_API void helix2_stream_init(helix2_stream_t* stream, const uint8_t* key, const uint8_t* nonce, uint64_t start_offset) {
+    helix2_initialize_key(&stream->schedule, key, nonce);
+    helix2_stream_seek(stream, start_offset);
+}
+
+// Move the stream to a keystream offset, the next update builds the block for it
+HELIX2_API void helix2_stream_seek(helix2_stream_t* stream, uint64_t offset) {
+    stream->offset = offset;
+    stream->available = 0;
+}
+
+// Encrypt/Decrypt the next size bytes of the stream
+//   Keystream left over from the previous update is used first, a block is only built once for the whole stream.
+HELIX2_API void helix2_stream_update(helix2_stream_t* stream, uint8_t* buffer, size_t size) {
+    if (stream->available > 0) {
+        size_t chunk = stream->available < size ? stream->available : size;
+        _helix2_xor(buffer, buffer, (uint8_t *)stream->stream + HELIX2_KEYSTREAM_SIZE - stream->available, chunk);
+        _HELIX2_STATS_BYTES(chunk);
+
+        buffer += chunk;
+        size -= chunk;
+        stream->available -= chunk;
+        stream->offset += chunk;
+    }
+    if (size == 0) return;
+
+    _helix2_process(stream->schedule.state, stream->schedule.rows, stream->schedule.state[11], buffer, buffer, size, stream->offset, stream->stream, _HELIX2_OUTPUT_XOR);
+    stream->offset += size;
+
+    // stream now holds the block of the last byte, whatever follows it in that block is left for the next update
+    size_t block_offset = stream->offset % HELIX2_KEYSTREAM_SIZE;
+    stream->available = block_offset != 0 ? HELIX2_KEYSTREAM_SIZE - block_offset : 0;
+}
+
+
+// Name of a keystream backend, also for backends this build or CPU does not support
+HELIX2_API const char* helix2_backend_name(helix2_backend_t backend) {
+    switch (backend) {
+        case HELIX2_BACKEND_AUTO:   return "auto";
+        case HELIX2_BACKEND_SCALAR: return "scalar";
+        case HELIX2_BACKEND_SSE2:   return "sse2";
+        case HELIX2_BACKEND_AVX2:   return "avx2";
+        case HELIX2_BACKEND_AVX512: return "avx512";
+        case HELIX2_BACKEND_NEON:   return "neon";
+    }
+    return "unknown";
+}
+
+// Is the backend both built into the library and supported by this CPU
+HELIX2_API bool helix2_backend_supported(helix2_backend_t backend) {
+    if (backend == HELIX2_BACKEND_AUTO) return true;
+
+    const _helix2_engine_t *engine = _helix2_find_engine(backend);
+    return engine != NULL && (_helix2_usable_engines() >> (engine - _helix2_engines)) & 1u;
+}
+
+// The backend used by all contexts
+HELIX2_API helix2_backend_t helix2_get_backend(void) {
+    return _helix2_get_engine()->backend;
+}
+
+// Force a backend (mainly for testing), HELIX2_BACKEND_AUTO restores the runtime selected one
+//   Returns false and keeps the current backend if it is not supported.
+HELIX2_API bool helix2_set_backend(helix2_backend_t backend) {
+    if (backend == HELIX2_BACKEND_AUTO) {
+        atomic_store_explicit(&_helix2_engine, NULL, memory_order_release);
+        _helix2_get_engine();
+        return true;
+    }
+    if (!helix2_backend_supported(backend)) return false;
+
+    atomic_store_explicit(&_helix2_engine, _helix2_find_engine(backend), memory_order_release);
+    return true;
+}
+
+
+// Internal helper functions
+// The selected keystream engine, the widest one supported by the CPU unless forced by helix2_set_backend
+const _helix2_engine_t *_helix2_get_engine(void) {
+    const _helix2_engine_t *engine = atomic_load_explicit(&_helix2_engine, memory_order_acquire);
+    if (engine == NULL) {
+        unsigned int usable = _helix2_usable_engines();
+        size_t best = 0;
+        for (size_t i = 0; i < _HELIX2_ENGINE_COUNT; i++) {
+            if ((usable >> i) & 1u) best = i;
+        }
+
+        // Only fill an unset selection, a backend forced meanwhile by helix2_set_backend wins
+        const _helix2_engine_t *expected = NULL;
+        engine = &_helix2_engines[best];
+        if (!atomic_compare_exchange_strong_explicit(&_helix2_engine, &expected, engine, memory_order_acq_rel, memory_order_acquire)) {
+            engine = expected;
+        }
+    }
+    return engine;
+}
+
+// The widest usable engine, no wider than the selected one, that fits in the given number of blocks
+const _helix2_engine_t *_helix2_get_engine_for(size_t blocks) {
+    const _helix2_engine_t *engine = _helix2_get_engine();
+    unsigned int usable = _helix2_usable_engines();
+    while (engine > &_helix2_engines[0] && (engine->blocks > blocks || !((usable >> (engine - _helix2_engines)) & 1u))) {
+        engine--;
+    }
+    return engine;
+}
+
+// Engines this CPU runs, detected on first use
+//   Racing first calls detect the same set and store the same value, the scalar bit keeps it non-zero.
+static unsigned int _helix2_usable_engines(void) {
+    unsigned int usable = atomic_load_explicit(&_helix2_engine_usable, memory_order_acquire);
+    if (usable == 0) {
+        for (size_t i = 0; i < _HELIX2_ENGINE_COUNT; i++) {
+            if (_helix2_cpu_supports(_helix2_engines[i].backend)) usable |= 1u << i;
+        }
+        atomic_store_explicit(&_helix2_engine_usable, usable, memory_order_release);
+    }
+    return usable;
+}
+
+static const _helix2_engine_t *_helix2_find_engine(helix2_backend_t backend) {
+    for (size_t i = 0; i < _HELIX2_ENGINE_COUNT; i++) {
+        if (_helix2_engines[i].backend == backend) return &_helix2_engines[i];
+    }
+    return NULL;
+}
+
+#if defined(HELIX2_ARCH_X86)
+// XCR0, the register state the OS saves on context switches (only valid when OSXSAVE is set)
+static uint64_t _helix2_xgetbv(void) {
+    uint32_t eax, edx;
+    __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+}
+#endif
+
+// Runtime CPU feature detection (cpuid on x86, getauxval on 32-bit ARM Linux)
+static bool _helix2_cpu_supports(helix2_backend_t backend) {
+    switch (backend) {
+        case HELIX2_BACKEND_SCALAR:
+            return true;
+#if defined(HELIX2_ARCH_X86)
+        case HELIX2_BACKEND_SSE2: {
+            unsigned int eax, ebx, ecx, edx;
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+            return (edx & bit_SSE2) != 0;
+        }
+        case HELIX2_BACKEND_AVX2:
+        case HELIX2_BACKEND_AVX512: {
+            unsigned int eax, ebx, ecx, edx;
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+            if ((ecx & bit_OSXSAVE) == 0 || (ecx & bit_AVX) == 0) return false;
+
+            uint64_t xcr0 = _helix2_xgetbv();
+            if ((xcr0 & 0x06) != 0x06) return false;        // XMM and YMM state
+            if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+
+            if (backend == HELIX2_BACKEND_AVX2) return (ebx & bit_AVX2) != 0;
+            if ((xcr0 & 0xE0) != 0xE0) return false;        // opmask and ZMM state
+            return (ebx & bit_AVX512F) != 0;
+        }
+#elif defined(HELIX2_ARCH_ARM)
+        case HELIX2_BACKEND_NEON:
+    #if defined(__aarch64__) || defined(_M_ARM64)
+            return true;                                    // Advanced SIMD is mandatory on AArch64
+    #elif defined(__linux__)
+            return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+    #else
+            return false;
+    #endif
+#endif
+        default:
+            return false;
+    }
+}
+
+// Pack the magic constant, key and nonce into the 16-word state (block index 0)
+static void _helix2_pack_state(uint32_t *state, const uint8_t *key, const uint8_t *nonce) {
+    const uint8_t *magic_constant = (uint8_t*)"so!M4g1c";       // every little code needs some magic
+    state[0] = _pack4(&magic_constant[0]);   // use pack4 to convert 8 bytes to 2 uint32_t
+    state[1] = _pack4(&magic_constant[4]);
+
+    // Pack key using _pack4 (since key comes as bytes)
+    state[2] = _pack4(&key[0]);
+    state[3] = _pack4(&key[4]);
+    state[4] = _pack4(&key[8]);
+    state[5] = _pack4(&key[12]);
+    state[6] = _pack4(&key[16]);
+    state[7] = _pack4(&key[20]);
+    state[8] = _pack4(&key[24]);
+    state[9] = _pack4(&key[28]);
+
+    _helix2_pack_nonce(state, nonce);
+}
+
+// Pack the nonce words of a state, the counter words back at block index 0
+static void _helix2_pack_nonce(uint32_t *state, const uint8_t *nonce) {
+    state[10] = 0;                   // This will hold the block index, assigned later
+
+    // Pack nonce using _pack4 (since nonce comes as bytes)
+    state[11] = _pack4(&nonce[0]);   // The high bits of the block index, will be XORed here later
+    state[12] = _pack4(&nonce[4]);
+    state[13] = _pack4(&nonce[8]);
+    state[14] = _pack4(&nonce[12]);
+    state[15] = _pack4(&nonce[16]);
+}
+
+// Round 1 row shuffles that only read the key and nonce words, the block functions start from these rows
+//   Words 8 to 11 (the counter row) are copied unshuffled for completeness, the engines replace them per block.
+static void _helix2_pack_rows(const uint32_t *state, uint32_t *rows) {
+    memcpy(rows, state, HELIX2_KEYSTREAM_SIZE);
+    _HELIX2_SHUFFLE32(rows, 0, 1, 2, 3);
+    _HELIX2_SHUFFLE32(rows, 4, 5, 6, 7);
+    _helix2_pack_nonce_row(state, rows);
+}
+
+// Redo only the nonce row of the cached rows, after a nonce change under the same key
+static void _helix2_pack_nonce_row(const uint32_t *state, uint32_t *rows) {
+    memcpy(&rows[8], &state[8], 8 * sizeof(uint32_t));
+    _HELIX2_SHUFFLE32(rows, 12, 13, 14, 15);
+}
+
+// Core of the buffer functions, dst = src ^ keystream (or dst = keystream) starting at keystream offset start_offset
+//   state is only read, stream is 16 words of scratch that ends up holding the last block used,
+//   output is one of the _HELIX2_OUTPUT_* modes (src is ignored for the keystream modes).
+//   Returns the block index of that last block.
+static uint64_t _helix2_process(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint8_t *dst, const uint8_t *src, size_t size, uint64_t start_offset, uint32_t *stream, int output) {
     // Calculate starting block and offset within that block
     uint64_t current_block = start_offset / HELIX2_KEYSTREAM_SIZE;
-    uint8_t block_offset = start_offset % HELIX2_KEYSTREAM_SIZE;
+    size_t block_offset = start_offset % HELIX2_KEYSTREAM_SIZE;
+    uint8_t *keystream_bytes = (uint8_t *)stream;
+
+    _HELIX2_STATS_CALL(size);
+
+    // Leading partial block (or a buffer shorter than a block)
+    if (block_offset != 0 || size < HELIX2_KEYSTREAM_SIZE) {
+        size_t chunk = HELIX2_KEYSTREAM_SIZE - block_offset;
+        if (chunk > size) chunk = size;
+
+        _helix2_keystream_scalar(state, rows, nonce_word, current_block, stream, 1);
+        _HELIX2_STATS_BLOCKS(HELIX2_BACKEND_SCALAR, 1);
+        _HELIX2_STATS_PARTIAL(1);
+        _helix2_output(dst, src, keystream_bytes + block_offset, chunk, output);
+
+        dst += chunk;
+        src += chunk;
+        size -= chunk;
+        current_block++;
+    }
+
+    // Whole blocks, in batches from the widest engine the remaining length covers
+    if (size >= HELIX2_KEYSTREAM_SIZE) {
+        _Alignas(64) uint32_t keystream[HELIX2_MAX_BLOCKS * HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+        const uint8_t *last = NULL;
+        size_t blocks;
+
+        // Raw keystream into word aligned memory goes straight from the engine to dst
+        bool direct = output == _HELIX2_OUTPUT_KEYSTREAM && ((uintptr_t)dst % sizeof(uint32_t)) == 0;
+
+        do {
+            blocks = size / HELIX2_KEYSTREAM_SIZE;
+            if (blocks > HELIX2_MAX_BLOCKS) blocks = HELIX2_MAX_BLOCKS;
 
-    _helix2_initialize_keystream(context, current_block);
+            const _helix2_engine_t *engine = _helix2_get_engine_for(blocks);
+            blocks -= blocks % engine->blocks;
+            _HELIX2_STATS_BLOCKS(engine->backend, blocks);
 
-    uint8_t *keystream_bytes = (uint8_t *)context->stream;
-    for (size_t i = 0; i < size; i++) {
-        // Do I need to calculate a new keystream block?
-        if (block_offset >= HELIX2_KEYSTREAM_SIZE) {
-            current_block++;
-            block_offset = 0;
-            _helix2_initialize_keystream(context, current_block);
+            if (direct) {
+                engine->keystream(state, rows, nonce_word, current_block, (uint32_t *)dst, blocks);
+                last = dst + (blocks - 1) * HELIX2_KEYSTREAM_SIZE;
+            } else {
+                engine->keystream(state, rows, nonce_word, current_block, keystream, blocks);
+                _helix2_output(dst, src, (uint8_t *)keystream, blocks * HELIX2_KEYSTREAM_SIZE, output);
+                last = (uint8_t *)&keystream[(blocks - 1) * 16];
+            }
+
+            dst += blocks * HELIX2_KEYSTREAM_SIZE;
+            src += blocks * HELIX2_KEYSTREAM_SIZE;
+            size -= blocks * HELIX2_KEYSTREAM_SIZE;
+            current_block += blocks;
+        } while (size >= HELIX2_KEYSTREAM_SIZE);
+
+        if (size == 0) {
+            memcpy(stream, last, HELIX2_KEYSTREAM_SIZE);
         }
-        
-        // Encrypt/Decrypt the byte
-        buffer[i] ^= keystream_bytes[block_offset];
-        
-        // Move to next byte in keystream
-        block_offset++;
     }
+
+    // Trailing partial block
+    if (size > 0) {
+        _helix2_keystream_scalar(state, rows, nonce_word, current_block, stream, 1);
+        _HELIX2_STATS_BLOCKS(HELIX2_BACKEND_SCALAR, 1);
+        _HELIX2_STATS_PARTIAL(1);
+        _helix2_output(dst, src, keystream_bytes, size, output);
+        current_block++;
+    }
+
+#if defined(HELIX2_ARCH_X86)
+    // Make the non-temporal stores visible before returning
+    if (output == _HELIX2_OUTPUT_KEYSTREAM_NT) _helix2_stream_fence_sse2();
+#endif
+
+    return current_block - 1;
 }
 
+// Queue the blocks of one short message, state supplies the key and nonce words, and the block index is set per lane
+//   stream, if set, receives the keystream block of the message's last byte once the lanes run.
+static void _helix2_queue_blocks(_helix2_lane_queue_t *queue, const uint32_t *state, uint32_t nonce_word, uint8_t *data, size_t size, uint64_t start_offset, uint32_t *stream) {
+    uint64_t block = start_offset / HELIX2_KEYSTREAM_SIZE;
+    size_t block_offset = start_offset % HELIX2_KEYSTREAM_SIZE;
 
-// Internal helper functions
-// Standard rotate left for 32-bit integers
-static inline uint32_t _rotl32(uint32_t x, int n) {
-	return (x << n) | (x >> (32 - n));
+    while (size > 0) {
+        size_t chunk = HELIX2_KEYSTREAM_SIZE - block_offset;
+        if (chunk > size) chunk = size;
+
+        uint32_t *lane_state = &queue->states[queue->queued * 16];
+        memcpy(lane_state, state, HELIX2_KEYSTREAM_SIZE);
+        _helix2_set_block_index(lane_state, nonce_word, block);
+        queue->lanes[queue->queued] = (_helix2_lane_t){ data, block_offset, chunk, chunk == size ? stream : NULL };
+        if (chunk < HELIX2_KEYSTREAM_SIZE) _HELIX2_STATS_PARTIAL(1);
+
+        if (++queue->queued == HELIX2_MAX_BLOCKS) _helix2_flush_lanes(queue);
+
+        data += chunk;
+        size -= chunk;
+        block++;
+        block_offset = 0;
+    }
+}
+
+// Run queued lane states through the widest engines that fit, then XOR every lane into its message bytes
+static void _helix2_flush_lanes(_helix2_lane_queue_t *queue) {
+    size_t count = queue->queued;
+    for (size_t i = 0; i < count; ) {
+        const _helix2_engine_t *engine = _helix2_get_engine_for(count - i);
+        engine->lanes(&queue->states[i * 16], &queue->keystream[i * 16]);
+        _HELIX2_STATS_BLOCKS(engine->backend, engine->blocks);
+        i += engine->blocks;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const _helix2_lane_t *lane = &queue->lanes[i];
+        const uint8_t *keystream_bytes = (const uint8_t *)&queue->keystream[i * 16] + lane->block_offset;
+        _helix2_xor(lane->data, lane->data, keystream_bytes, lane->size);
+        if (lane->stream != NULL) memcpy(lane->stream, &queue->keystream[i * 16], HELIX2_KEYSTREAM_SIZE);
+    }
+    queue->queued = 0;
+}
+
+// Is a block that writes stream still queued
+static bool _helix2_queue_pending(const _helix2_lane_queue_t *queue, const uint32_t *stream) {
+    for (size_t i = 0; i < queue->queued; i++) {
+        if (queue->lanes[i].stream == stream) return true;
+    }
+    return false;
+}
+
+// Walk segments as one stream, stream carries the block shared by the end of one segment and the start of the next
+//   Returns the block index of the last block used, like _helix2_process (the start block if all segments are empty).
+static uint64_t _helix2_process_iov(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, const helix2_iovec_t *iov, size_t iov_count, uint64_t start_offset, uint32_t *stream) {
+    uint64_t offset = start_offset;
+    uint64_t stream_block = 0;
+    bool stream_valid = false;
+
+    for (size_t i = 0; i < iov_count; i++) {
+        uint8_t *data = (uint8_t *)iov[i].base;
+        size_t size = iov[i].length;
+        size_t block_offset = offset % HELIX2_KEYSTREAM_SIZE;
+
+        // Rest of the block the previous segment ended in
+        if (block_offset != 0 && stream_valid && stream_block == offset / HELIX2_KEYSTREAM_SIZE) {
+            size_t chunk = HELIX2_KEYSTREAM_SIZE - block_offset;
+            if (chunk > size) chunk = size;
+
+            _helix2_xor(data, data, (uint8_t *)stream + block_offset, chunk);
+            _HELIX2_STATS_BYTES(chunk);
+            data += chunk;
+            size -= chunk;
+            offset += chunk;
+        }
+        if (size == 0) continue;
+
+        stream_block = _helix2_process(state, rows, nonce_word, data, data, size, offset, stream, _HELIX2_OUTPUT_XOR);
+        stream_valid = true;
+        offset += size;
+    }
+
+    if (!stream_valid) {
+        stream_block = _helix2_process(state, rows, nonce_word, (uint8_t *)stream, (uint8_t *)stream, 0, start_offset, stream, _HELIX2_OUTPUT_XOR);
+    }
+    return stream_block;
+}
+
+// Output mode for raw keystream of the given size
+static int _helix2_keystream_output(size_t size) {
+#if defined(HELIX2_ARCH_X86)
+    if (size >= HELIX2_NONTEMPORAL_MIN && helix2_backend_supported(HELIX2_BACKEND_SSE2)) return _HELIX2_OUTPUT_KEYSTREAM_NT;
+#endif
+    (void)size;
+    return _HELIX2_OUTPUT_KEYSTREAM;
+}
+
+// Write a run of keystream to dst, XORed with src or as raw keystream
+static inline void _helix2_output(uint8_t *dst, const uint8_t *src, const uint8_t *keystream, size_t size, int output) {
+    if (output == _HELIX2_OUTPUT_XOR) {
+        _helix2_xor(dst, src, keystream, size);
+#if defined(HELIX2_ARCH_X86)
+    } else if (output == _HELIX2_OUTPUT_KEYSTREAM_NT) {
+        _helix2_stream_copy_sse2(dst, keystream, size);
+#endif
+    } else {
+        memcpy(dst, keystream, size);
+    }
+}
+
+// Set the counter words of a state to a block index, the high bits are XORed into the nonce word
+static inline void _helix2_set_block_index(uint32_t *state, uint32_t nonce_word, uint64_t block_index) {
+    state[10] = (uint32_t)(block_index & 0xFFFFFFFF);
+    state[11] = nonce_word ^ (uint32_t)((block_index >> 32) & 0xFFFFFFFF);
 }
 
 // Standard pack 4 bytes into a uint32_t (little-endian)
@@ -132,70 +776,43 @@ static inline uint32_t _pack4(const uint8_t *a) {
 	return res;
 }
 
-// The core Helix2 keystream operations
-static inline void _helix2_shuffle(uint32_t *state, uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
-    
-    state[c] += _rotl32(((state[a] ^ state[b]) + state[d]), 9);
-    state[d] ^= _rotl32(((state[b] + state[c]) ^ state[a]), 13);
-    state[a] += _rotl32(((state[c] ^ state[d]) + state[b]), 18);
-    state[b] ^= _rotl32(((state[d] + state[a]) ^ state[c]), 22);
-
-    state[c] ^= _rotl32((state[a] + state[b]), 7);
-    state[d] += _rotl32((state[b] ^ state[c]), 21);
-    state[a] ^= _rotl32((state[c] + state[d]), 11);
-    state[b] += _rotl32((state[d] ^ state[a]), 16);
-
+// Key schedule of a context, the counter words back at block index 0
+void _helix2_context_key(const helix2_context_t* context, helix2_key_t* schedule) {
+    memcpy(schedule->state, context->state, sizeof(schedule->state));
+    memcpy(schedule->rows, context->rows, sizeof(schedule->rows));
+    _helix2_set_block_index(schedule->state, context->nonce_word, 0);
 }
 
 // Build the keystream for the current block index
 void _helix2_initialize_keystream(helix2_context_t* context, uint64_t block_index) {
 
     // Update the block index in the state
-    context->state[10] = (uint32_t)(block_index & 0xFFFFFFFF);
-    context->state[11] = _pack4(&context->nonce[0]) ^ (uint32_t)((block_index >> 32) & 0xFFFFFFFF);
-    // Initialize the stream with the current state
-    memcpy(context->stream, context->state, HELIX2_KEYSTREAM_SIZE);
-
-    // Round 1 (Shuffle rows and diagonals)
-    _helix2_shuffle(context->stream, 0,  1,  2,  3);
-    _helix2_shuffle(context->stream, 4,  5,  6,  7);
-    _helix2_shuffle(context->stream, 8,  9,  10, 11);
-    _helix2_shuffle(context->stream, 12, 13, 14, 15);      
-
-    _helix2_shuffle(context->stream, 0, 5, 10, 15);
-    _helix2_shuffle(context->stream, 1, 6, 11, 12);
-    _helix2_shuffle(context->stream, 2, 7, 8,  13);
-    _helix2_shuffle(context->stream, 3, 4, 9,  14);    
-
-    // Add the original state to the stream, round 1
-    context->stream[0]  += context->state[0];  context->stream[1]  += context->state[1];
-    context->stream[2]  += context->state[2];  context->stream[3]  += context->state[3];
-    context->stream[4]  += context->state[4];  context->stream[5]  += context->state[5];
-    context->stream[6]  += context->state[6];  context->stream[7]  += context->state[7];
-    context->stream[8]  += context->state[8];  context->stream[9]  += context->state[9];
-    context->stream[10] += context->state[10]; context->stream[11] += context->state[11];
-    context->stream[12] += context->state[12]; context->stream[13] += context->state[13];
-    context->stream[14] += context->state[14]; context->stream[15] += context->state[15];
-
-    // Round 2 (Shuffle columns and mirrored diagonals)
-    _helix2_shuffle(context->stream, 0, 4, 8,  12);
-    _helix2_shuffle(context->stream, 1, 5, 9,  13);
-    _helix2_shuffle(context->stream, 2, 6, 10, 14);
-    _helix2_shuffle(context->stream, 3, 7, 11, 15);        
-
-    _helix2_shuffle(context->stream, 3, 6, 9,  12);
-    _helix2_shuffle(context->stream, 2, 5, 8,  15);
-    _helix2_shuffle(context->stream, 1, 4, 11, 14);
-    _helix2_shuffle(context->stream, 0, 7, 10, 13);
-
-    // Add the original state to the stream, round 2
-    context->stream[0]  += context->state[0];  context->stream[1]  += context->state[1];
-    context->stream[2]  += context->state[2];  context->stream[3]  += context->state[3];
-    context->stream[4]  += context->state[4];  context->stream[5]  += context->state[5];
-    context->stream[6]  += context->state[6];  context->stream[7]  += context->state[7];
-    context->stream[8]  += context->state[8];  context->stream[9]  += context->state[9];
-    context->stream[10] += context->state[10]; context->stream[11] += context->state[11];
-    context->stream[12] += context->state[12]; context->stream[13] += context->state[13];
-    context->stream[14] += context->state[14]; context->stream[15] += context->state[15];
-
-}
\ No newline at end of file
+    _helix2_set_block_index(context->state, context->nonce_word, block_index);
+
+    _helix2_rounds_block(context->state, context->rows, context->stream);
+    _HELIX2_STATS_BLOCKS(HELIX2_BACKEND_SCALAR, 1);
+    _HELIX2_STATS_PARTIAL(1);
+}
+
+// Scalar keystream engine, same contract as the multi-block engines in helix2_internal.h
+void _helix2_keystream_scalar(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks) {
+    uint32_t block_state[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    memcpy(block_state, state, HELIX2_KEYSTREAM_SIZE);
+
+    for (size_t n = 0; n < blocks; n++, block_index++) {
+        _helix2_set_block_index(block_state, nonce_word, block_index);
+        _helix2_rounds_block(block_state, rows, &out[n * 16]);
+    }
+}
+
+// Scalar lanes engine, one independent block state
+void _helix2_lanes_scalar(const uint32_t *states, uint32_t *out) {
+    _helix2_block(states, out);
+}
+
+// Run both rounds over one block state into stream
+static inline void _helix2_block(const uint32_t *state, uint32_t *stream) {
+    uint32_t rows[16];
+    _helix2_pack_rows(state, rows);
+    _helix2_rounds_block(state, rows, stream);
+}
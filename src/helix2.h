@@ -6,29 +6,284 @@
 #include <stdbool.h>
 #include <string.h>
 
-// DLL export/import macros
-#ifdef _HELIX2_DLL
-    #ifdef _HELIX2_EXPORT
-        #define HELIX2_API __declspec(dllexport)
+// Export/import macros, the library sources define _HELIX2_EXPORT
+//   Windows: define _HELIX2_DLL when building or using helix2.dll. ELF: the shared library is built with
+//   -fvisibility=hidden, so only HELIX2_API functions are exported (versioned by src/helix2.map).
+#if defined(_WIN32) || defined(__CYGWIN__)
+    #ifdef _HELIX2_DLL
+        #ifdef _HELIX2_EXPORT
+            #define HELIX2_API __declspec(dllexport)
+        #else
+            #define HELIX2_API __declspec(dllimport)
+        #endif
     #else
-        #define HELIX2_API __declspec(dllimport)
+        #define HELIX2_API
     #endif
+#elif defined(__GNUC__) || defined(__clang__)
+    #define HELIX2_API __attribute__((visibility("default")))
 #else
     #define HELIX2_API
 #endif
 
+// Alignment of a struct member, C11 and C++11
+#ifdef __cplusplus
+    #define HELIX2_ALIGNED(n) alignas(n)
+#else
+    #define HELIX2_ALIGNED(n) _Alignas(n)
+#endif
+
 // HELIX2 definitions
 #define HELIX2_KEYSTREAM_SIZE 64
+#define HELIX2_CACHE_LINE     64
+#define HELIX2_OPENCL_CHUNK   (4 * 1024 * 1024)    // default size of each pinned buffer of an OpenCL device, bytes per kernel launch
 
+// Context, the key and nonce only live packed in state, rows and state are next to each other for the block functions
 typedef struct
 {
-    uint8_t nonce[20];
-    uint8_t key[32];
-    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
     uint32_t state[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    uint32_t rows[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];     // round 1 rows that do not depend on the block index
+    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];   // keystream block of the last byte processed
+    uint32_t nonce_word;            // packed nonce[0..3], the high block index bits are XORed into it
 } helix2_context_t;
 
+// Compact session, one cache line: the packed constant, key and nonce at block index 0 (the state of a helix2_key_t)
+//   For large numbers of long-lived sessions, the round 1 rows and the keystream scratch are rebuilt on the stack per call.
+typedef struct
+{
+    HELIX2_ALIGNED(HELIX2_CACHE_LINE) uint32_t state[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+} helix2_session_t;
+
+// Keystream prefetch ring for one sequential stream, see helix2_prefetch_create
+typedef struct helix2_prefetch helix2_prefetch_t;
+
+// Keystream cache for repeated random access under one key schedule, see helix2_cache_create
+#define HELIX2_CACHE_PAGE     4096      // cached unit, 64 blocks
+
+typedef struct helix2_cache helix2_cache_t;
+
+typedef struct
+{
+    uint64_t hits;                  // pages found in the cache
+    uint64_t misses;                // pages generated
+    uint64_t evictions;             // pages replaced to make room
+    uint64_t bypassed_bytes;        // bytes of calls too large to cache, processed directly
+    uint64_t cached_bytes;          // keystream held now
+    uint64_t capacity;              // cache size in bytes, whole pages
+} helix2_cache_stats_t;
+
+// Pool of cache line aligned objects (sessions, key schedules, contexts) allocated in bulk, see helix2_pool_create
+typedef struct helix2_pool helix2_pool_t;
+
+// Read-only key schedule (packed constant, key and nonce), can be shared between threads
+typedef struct
+{
+    uint32_t state[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    uint32_t rows[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];     // round 1 rows that do not depend on the block index
+} helix2_key_t;
+
+// Asynchronous bulk keystream queue, see helix2_async_create
+typedef struct helix2_async helix2_async_t;
+typedef uint64_t helix2_ticket_t;           // job handle from helix2_async_submit, 0 is never a valid ticket
+
+// Offload device for the asynchronous queue (ex. a GPU kernel over pinned host buffers), all members may be NULL
+//   process runs on a queue worker for one job: dst = src ^ keystream, or raw keystream if src is NULL, for
+//   [start_offset, start_offset + size) under schedule. The block counter of byte offset o is o / HELIX2_KEYSTREAM_SIZE
+//   (see helix2_key_t). Return false to leave the job to the CPU engines.
+typedef struct
+{
+    bool (*process)(void* device, const helix2_key_t* schedule, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset);
+    void* device;
+} helix2_offload_t;
+
+// OpenCL offload device of a library built with make GPU=opencl, see helix2_opencl_create
+typedef struct helix2_opencl helix2_opencl_t;
+
+// Sequential stream, remembers its position and the unused keystream of the current block
+typedef struct
+{
+    helix2_key_t schedule;
+    uint64_t offset;                // keystream offset of the next byte
+    size_t available;               // unused keystream bytes at the end of stream
+    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+} helix2_stream_t;
+
+// One segment of a scatter/gather list, same member order as POSIX struct iovec
+typedef struct
+{
+    void* base;
+    size_t length;
+} helix2_iovec_t;
+
+// One message of a batch, encrypted under its own 20-byte nonce starting at keystream offset start_offset
+typedef struct
+{
+    const uint8_t* nonce;
+    uint8_t* buffer;
+    size_t size;
+    uint64_t start_offset;
+} helix2_message_t;
+
+// One message of a multi-key batch, encrypted with its own key schedule starting at keystream offset start_offset
+typedef struct
+{
+    const helix2_key_t* schedule;
+    uint8_t* buffer;
+    size_t size;
+    uint64_t start_offset;
+} helix2_key_message_t;
+
+// One message of a multi-key batch, encrypted with its own context like helix2_buffer
+typedef struct
+{
+    helix2_context_t* context;
+    uint8_t* buffer;
+    size_t size;
+    uint64_t start_offset;
+} helix2_context_message_t;
+
+// Parallel processing options, a NULL helix2_parallel_t* uses one thread per online CPU
+//   threads      : number of threads to use, 0 = one per online CPU
+//   parallel_for : optional caller thread pool, must call task(task_arg, i) for every i in [0, count)
+//                  (in any order, on any threads) and return once all calls have finished
+//   pool         : passed through to parallel_for
+typedef void (*helix2_task_fn)(void* task_arg, size_t index);
+
+typedef struct
+{
+    unsigned int threads;
+    void (*parallel_for)(void* pool, helix2_task_fn task, void* task_arg, size_t count);
+    void* pool;
+} helix2_parallel_t;
+
+// Keystream backends, the widest one supported by the CPU is selected at runtime
+typedef enum
+{
+    HELIX2_BACKEND_AUTO = 0,
+    HELIX2_BACKEND_SCALAR,
+    HELIX2_BACKEND_SSE2,
+    HELIX2_BACKEND_AVX2,
+    HELIX2_BACKEND_AVX512,
+    HELIX2_BACKEND_NEON
+} helix2_backend_t;
+
+#define HELIX2_BACKEND_COUNT  (HELIX2_BACKEND_NEON + 1)
+
+// Hot path counters, only recorded by a library built with HELIX2_STATS (make STATS=1)
+//   Every thread counts into its own slot, helix2_get_stats adds them up, slots of finished threads are kept and reused.
+//   A call is one run through the buffer core: a buffer/keystream call, an iov segment, a parallel chunk or a batch message.
+#define HELIX2_STATS_BUCKETS  24
+
+typedef struct
+{
+    uint64_t calls;
+    uint64_t bytes;                 // bytes encrypted, decrypted or written as keystream
+    uint64_t blocks;                // keystream blocks generated
+    uint64_t partial_blocks;        // blocks generated for less than 64 bytes (unaligned ends, short calls, context refresh)
+    uint64_t discarded_bytes;       // keystream generated but never used, blocks * 64 - bytes
+    uint64_t backend_blocks[HELIX2_BACKEND_COUNT];      // blocks per keystream backend
+    uint64_t size_histogram[HELIX2_STATS_BUCKETS];      // calls by size, bucket i holds [2^i, 2^(i+1)), 0 is counted in bucket 0, the last one is open
+    helix2_backend_t backend;       // backend selected now
+    unsigned int threads;           // threads that recorded counters
+} helix2_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Exported functions
 HELIX2_API void helix2_initialize_context(helix2_context_t* context, const uint8_t* key, uint8_t* nonce);
 HELIX2_API void helix2_buffer(helix2_context_t* context, uint8_t* buffer, size_t size, uint64_t start_offset);
+HELIX2_API void helix2_set_nonce(helix2_context_t* context, const uint8_t* nonce);
+HELIX2_API void helix2_buffer_nonce(helix2_context_t* context, const uint8_t* nonce, uint8_t* buffer, size_t size, uint64_t start_offset);
+
+HELIX2_API void helix2_buffer_copy(helix2_context_t* context, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset);
+HELIX2_API void helix2_buffer_iov(helix2_context_t* context, const helix2_iovec_t* iov, size_t iov_count, uint64_t start_offset);
+HELIX2_API void helix2_keystream(helix2_context_t* context, uint8_t* out, size_t size, uint64_t start_offset);
+
+// Thread-safe shared key schedule
+HELIX2_API void helix2_initialize_key(helix2_key_t* schedule, const uint8_t* key, const uint8_t* nonce);
+HELIX2_API void helix2_key_set_nonce(helix2_key_t* schedule, const uint8_t* nonce);
+HELIX2_API void helix2_key_buffer(const helix2_key_t* schedule, uint8_t* buffer, size_t size, uint64_t start_offset);
+HELIX2_API void helix2_key_buffer_copy(const helix2_key_t* schedule, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset);
+HELIX2_API void helix2_key_buffer_iov(const helix2_key_t* schedule, const helix2_iovec_t* iov, size_t iov_count, uint64_t start_offset);
+HELIX2_API void helix2_key_keystream(const helix2_key_t* schedule, uint8_t* out, size_t size, uint64_t start_offset);
+
+// Many small messages under one key, their blocks share the SIMD lanes (the nonce of schedule is not used)
+HELIX2_API void helix2_key_buffer_batch(const helix2_key_t* schedule, const helix2_message_t* messages, size_t count);
+
+// Many small messages under different keys (one per session), their blocks share the SIMD lanes all the same
+HELIX2_API void helix2_key_buffer_multi(const helix2_key_message_t* messages, size_t count);
+HELIX2_API void helix2_buffer_multi(const helix2_context_message_t* messages, size_t count);
+
+// Random access into an encrypted file (POSIX pread / Windows positioned ReadFile), decrypts only [offset, offset + size)
+HELIX2_API int64_t helix2_key_pread(const helix2_key_t* schedule, int fd, uint8_t* buffer, size_t size, uint64_t offset);
+
+// Compact sessions, same keystream as helix2_key_buffer for the same key and nonce
+HELIX2_API void helix2_session_init(helix2_session_t* session, const uint8_t* key, const uint8_t* nonce);
+HELIX2_API void helix2_session_set_nonce(helix2_session_t* session, const uint8_t* nonce);
+HELIX2_API void helix2_session_key(const helix2_session_t* session, helix2_key_t* schedule);
+HELIX2_API void helix2_session_buffer(const helix2_session_t* session, uint8_t* buffer, size_t size, uint64_t start_offset);
+HELIX2_API void helix2_session_buffer_copy(const helix2_session_t* session, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset);
+
+// Bulk allocation of fixed size objects aligned to HELIX2_CACHE_LINE, not thread-safe (one pool per thread, or a lock)
+//   The pool grows by chunk_objects objects at a time, freed objects are wiped and reused, destroy releases everything.
+HELIX2_API helix2_pool_t* helix2_pool_create(size_t object_size, size_t chunk_objects);
+HELIX2_API void* helix2_pool_alloc(helix2_pool_t* pool);
+HELIX2_API void helix2_pool_free(helix2_pool_t* pool, void* object);
+HELIX2_API void helix2_pool_destroy(helix2_pool_t* pool);
+
+// Sequential streaming, small updates only pay for the bytes they consume
+HELIX2_API void helix2_stream_init(helix2_stream_t* stream, const uint8_t* key, const uint8_t* nonce, uint64_t start_offset);
+HELIX2_API void helix2_stream_seek(helix2_stream_t* stream, uint64_t offset);
+HELIX2_API void helix2_stream_update(helix2_stream_t* stream, uint8_t* buffer, size_t size);
+
+// Prefetched sequential streaming for latency-critical small updates, same stream as helix2_stream_update
+//   A producer (helix2_prefetch_fill from one thread, or the thread of helix2_prefetch_start) keeps the upcoming
+//   keystream in a lock-free single-producer single-consumer ring, the consumer (helix2_prefetch_update,
+//   helix2_prefetch_seek, helix2_prefetch_available, one thread) then only XORs and generates inline when the ring is empty.
+HELIX2_API helix2_prefetch_t* helix2_prefetch_create(const uint8_t* key, const uint8_t* nonce, uint64_t start_offset, size_t capacity);
+HELIX2_API size_t helix2_prefetch_fill(helix2_prefetch_t* prefetch, size_t max_bytes);
+HELIX2_API void helix2_prefetch_update(helix2_prefetch_t* prefetch, uint8_t* buffer, size_t size);
+HELIX2_API void helix2_prefetch_seek(helix2_prefetch_t* prefetch, uint64_t offset);
+HELIX2_API size_t helix2_prefetch_available(const helix2_prefetch_t* prefetch);
+HELIX2_API bool helix2_prefetch_start(helix2_prefetch_t* prefetch);
+HELIX2_API void helix2_prefetch_stop(helix2_prefetch_t* prefetch);
+HELIX2_API void helix2_prefetch_destroy(helix2_prefetch_t* prefetch);
+
+// Cached random access, hot regions reuse their keystream pages instead of running the rounds again (CLOCK replacement)
+HELIX2_API helix2_cache_t* helix2_cache_create(const helix2_key_t* schedule, size_t capacity);
+HELIX2_API void helix2_cache_buffer(helix2_cache_t* cache, uint8_t* buffer, size_t size, uint64_t start_offset);
+HELIX2_API void helix2_cache_get_stats(const helix2_cache_t* cache, helix2_cache_stats_t* stats);
+HELIX2_API void helix2_cache_destroy(helix2_cache_t* cache);
+
+// Asynchronous bulk processing, submit returns before the keystream is generated so the caller can overlap its I/O
+HELIX2_API helix2_async_t* helix2_async_create(unsigned int threads, size_t depth, const helix2_offload_t* offload);
+HELIX2_API helix2_ticket_t helix2_async_submit(helix2_async_t* async, const helix2_key_t* schedule, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset);
+HELIX2_API bool helix2_async_poll(helix2_async_t* async, helix2_ticket_t ticket);
+HELIX2_API void helix2_async_wait(helix2_async_t* async, helix2_ticket_t ticket);
+HELIX2_API void helix2_async_drain(helix2_async_t* async);
+HELIX2_API void helix2_async_destroy(helix2_async_t* async);
+
+// OpenCL keystream kernel (make GPU=opencl) for the asynchronous queue, create returns NULL when no device can run it
+HELIX2_API helix2_opencl_t* helix2_opencl_create(size_t chunk);
+HELIX2_API bool helix2_opencl_process(helix2_opencl_t* device, const helix2_key_t* schedule, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset);
+HELIX2_API helix2_offload_t helix2_opencl_offload(helix2_opencl_t* device);
+HELIX2_API void helix2_opencl_destroy(helix2_opencl_t* device);
+
+// Multi-threaded processing of large buffers, same output as helix2_buffer / helix2_key_buffer
+HELIX2_API void helix2_buffer_parallel(helix2_context_t* context, uint8_t* buffer, size_t size, uint64_t start_offset, const helix2_parallel_t* parallel);
+HELIX2_API void helix2_key_buffer_parallel(const helix2_key_t* schedule, uint8_t* buffer, size_t size, uint64_t start_offset, const helix2_parallel_t* parallel);
+
+// Keystream backend selection
+HELIX2_API helix2_backend_t helix2_get_backend(void);
+HELIX2_API bool helix2_set_backend(helix2_backend_t backend);
+HELIX2_API bool helix2_backend_supported(helix2_backend_t backend);
+HELIX2_API const char* helix2_backend_name(helix2_backend_t backend);
+
+// Counters of a HELIX2_STATS build added up over all threads, returns false (and zeros) when the library was built without them
+HELIX2_API bool helix2_get_stats(helix2_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
 #endif
\ No newline at end of file
@@ -0,0 +1,286 @@
+/**
+ * @file helix2.hpp
+ * @brief Helix2 Stream Cipher, optional C++17 header with compile-time unrolled keystream kernels
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HELIX2_INCL_HPP
+#define HELIX2_INCL_HPP
+
+// Optional C++17 header, compile-time unrolled keystream kernels on top of the C library
+//   The shuffle schedule is a set of constexpr index tables, every kernel is instantiated per block count
+//   and vector type, so all state indices are constants and the 16 state words stay in registers.
+//   Kernels run on a helix2_key_t (helix2_initialize_key) and produce the same keystream as helix2_key_keystream.
+//   The vector types available depend on the flags this header is compiled with (-msse2, -mavx2, -mavx512f, NEON),
+//   block counts without a matching vector type use a plain lane array the compiler may vectorize by itself.
+
+#include "helix2.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(__AVX2__) || defined(__AVX512F__)
+    #include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+namespace helix2 {
+namespace detail {
+
+// One shuffle of four state words, same argument order as _helix2_shuffle in helix2.c
+struct shuffle_t {
+    std::uint8_t a, b, c, d;
+};
+
+// Round 1 row shuffles that do not read the counter row, cached in helix2_key_t::rows
+struct fixed_rows {
+    static constexpr shuffle_t steps[] = { {0, 1, 2, 3}, {4, 5, 6, 7}, {12, 13, 14, 15} };
+};
+
+// Rest of round 1: the counter row, then the diagonals
+struct round1 {
+    static constexpr shuffle_t steps[] = { {8, 9, 10, 11}, {0, 5, 10, 15}, {1, 6, 11, 12}, {2, 7, 8, 13}, {3, 4, 9, 14} };
+};
+
+// Round 2: columns, then the mirrored diagonals
+struct round2 {
+    static constexpr shuffle_t steps[] = { {0, 4, 8, 12}, {1, 5, 9, 13}, {2, 6, 10, 14}, {3, 7, 11, 15},
+                                           {3, 6, 9, 12}, {2, 5, 8, 15}, {1, 4, 11, 14}, {0, 7, 10, 13} };
+};
+
+// Plain lane array, the fallback vector type for block counts without a SIMD type
+template <std::size_t N>
+struct lanes {
+    std::uint32_t v[N];
+};
+
+// Lane operations, one backend per vector type, `width` blocks per vector of type V
+//   Backends are tag types rather than the vector types themselves, SIMD types make poor template arguments.
+struct scalar_ops {
+    using V = std::uint32_t;
+    static constexpr std::size_t width = 1;
+    static V set1(std::uint32_t a) { return a; }
+    static V load(const std::uint32_t* a) { return a[0]; }
+    static void store(V x, std::uint32_t* a) { a[0] = x; }
+    static V add(V a, V b) { return a + b; }
+    static V bxor(V a, V b) { return a ^ b; }
+    template <int n> static V rotl(V x) { return (x << n) | (x >> (32 - n)); }
+};
+
+template <std::size_t N>
+struct lanes_ops {
+    using V = lanes<N>;
+    static constexpr std::size_t width = N;
+    static V set1(std::uint32_t a) { V r; for (std::size_t j = 0; j < N; j++) r.v[j] = a; return r; }
+    static V load(const std::uint32_t* a) { V r; for (std::size_t j = 0; j < N; j++) r.v[j] = a[j]; return r; }
+    static void store(const V& x, std::uint32_t* a) { for (std::size_t j = 0; j < N; j++) a[j] = x.v[j]; }
+    static V add(const V& a, const V& b) { V r; for (std::size_t j = 0; j < N; j++) r.v[j] = a.v[j] + b.v[j]; return r; }
+    static V bxor(const V& a, const V& b) { V r; for (std::size_t j = 0; j < N; j++) r.v[j] = a.v[j] ^ b.v[j]; return r; }
+    template <int n> static V rotl(const V& x) {
+        V r;
+        for (std::size_t j = 0; j < N; j++) r.v[j] = (x.v[j] << n) | (x.v[j] >> (32 - n));
+        return r;
+    }
+};
+
+#if defined(__SSE2__)
+struct sse2_ops {
+    using V = __m128i;
+    static constexpr std::size_t width = 4;
+    static V set1(std::uint32_t a) { return _mm_set1_epi32((int)a); }
+    static V load(const std::uint32_t* a) { return _mm_loadu_si128((const __m128i*)a); }
+    static void store(V x, std::uint32_t* a) { _mm_storeu_si128((__m128i*)a, x); }
+    static V add(V a, V b) { return _mm_add_epi32(a, b); }
+    static V bxor(V a, V b) { return _mm_xor_si128(a, b); }
+    template <int n> static V rotl(V x) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+};
+#endif
+
+#if defined(__AVX2__)
+struct avx2_ops {
+    using V = __m256i;
+    static constexpr std::size_t width = 8;
+    static V set1(std::uint32_t a) { return _mm256_set1_epi32((int)a); }
+    static V load(const std::uint32_t* a) { return _mm256_loadu_si256((const __m256i*)a); }
+    static void store(V x, std::uint32_t* a) { _mm256_storeu_si256((__m256i*)a, x); }
+    static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+    static V bxor(V a, V b) { return _mm256_xor_si256(a, b); }
+    template <int n> static V rotl(V x) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+};
+#endif
+
+#if defined(__AVX512F__)
+struct avx512_ops {
+    using V = __m512i;
+    static constexpr std::size_t width = 16;
+    static V set1(std::uint32_t a) { return _mm512_set1_epi32((int)a); }
+    static V load(const std::uint32_t* a) { return _mm512_loadu_si512((const void*)a); }
+    static void store(V x, std::uint32_t* a) { _mm512_storeu_si512((void*)a, x); }
+    static V add(V a, V b) { return _mm512_add_epi32(a, b); }
+    static V bxor(V a, V b) { return _mm512_xor_si512(a, b); }
+    // The zero-masked form, the unmasked one trips -Wuninitialized inside the GCC 12 headers in C++
+    template <int n> static V rotl(V x) { return _mm512_maskz_rol_epi32((__mmask16)0xFFFF, x, n); }
+};
+#endif
+
+#if defined(__ARM_NEON)
+struct neon_ops {
+    using V = uint32x4_t;
+    static constexpr std::size_t width = 4;
+    static V set1(std::uint32_t a) { return vdupq_n_u32(a); }
+    static V load(const std::uint32_t* a) { return vld1q_u32(a); }
+    static void store(V x, std::uint32_t* a) { vst1q_u32(a, x); }
+    static V add(V a, V b) { return vaddq_u32(a, b); }
+    static V bxor(V a, V b) { return veorq_u32(a, b); }
+    template <int n> static V rotl(V x) { return vsriq_n_u32(vshlq_n_u32(x, n), x, 32 - n); }
+};
+#endif
+
+// Widest backend for a block count, the lane array when the compile flags provide no vector type
+template <std::size_t Blocks> struct ops_for { using type = lanes_ops<Blocks>; };
+template <> struct ops_for<1> { using type = scalar_ops; };
+#if defined(__SSE2__)
+template <> struct ops_for<4> { using type = sse2_ops; };
+#elif defined(__ARM_NEON)
+template <> struct ops_for<4> { using type = neon_ops; };
+#endif
+#if defined(__AVX2__)
+template <> struct ops_for<8> { using type = avx2_ops; };
+#endif
+#if defined(__AVX512F__)
+template <> struct ops_for<16> { using type = avx512_ops; };
+#endif
+
+// One shuffle with its word indices as template arguments
+template <typename O, std::size_t a, std::size_t b, std::size_t c, std::size_t d>
+inline void shuffle(typename O::V* s) {
+    s[c] = O::add(s[c], O::template rotl<9>(O::add(O::bxor(s[a], s[b]), s[d])));
+    s[d] = O::bxor(s[d], O::template rotl<13>(O::bxor(O::add(s[b], s[c]), s[a])));
+    s[a] = O::add(s[a], O::template rotl<18>(O::add(O::bxor(s[c], s[d]), s[b])));
+    s[b] = O::bxor(s[b], O::template rotl<22>(O::bxor(O::add(s[d], s[a]), s[c])));
+
+    s[c] = O::bxor(s[c], O::template rotl<7>(O::add(s[a], s[b])));
+    s[d] = O::add(s[d], O::template rotl<21>(O::bxor(s[b], s[c])));
+    s[a] = O::bxor(s[a], O::template rotl<11>(O::add(s[c], s[d])));
+    s[b] = O::add(s[b], O::template rotl<16>(O::bxor(s[d], s[a])));
+}
+
+// Unroll a shuffle table at compile time
+template <typename O, typename Table, std::size_t... I>
+inline void run(typename O::V* s, std::index_sequence<I...>) {
+    (shuffle<O, Table::steps[I].a, Table::steps[I].b, Table::steps[I].c, Table::steps[I].d>(s), ...);
+}
+
+template <typename O, typename Table>
+inline void run(typename O::V* s) {
+    run<O, Table>(s, std::make_index_sequence<sizeof(Table::steps) / sizeof(shuffle_t)>{});
+}
+
+template <typename O, std::size_t... I>
+inline void add_state(typename O::V* x, const typename O::V* s, std::index_sequence<I...>) {
+    ((x[I] = O::add(x[I], s[I])), ...);
+}
+
+} // namespace detail
+
+// Build `Blocks` consecutive keystream blocks starting at block_index into out, 16 words per block
+//   Same output as helix2_key_keystream for the bytes [block_index * 64, (block_index + Blocks) * 64).
+template <std::size_t Blocks, typename O = typename detail::ops_for<Blocks>::type>
+inline void keystream_blocks(const helix2_key_t& schedule, std::uint64_t block_index, std::uint32_t* out) {
+    using V = typename O::V;
+    static_assert(O::width == Blocks, "backend must hold one lane per block");
+    constexpr auto words = std::make_index_sequence<16>{};
+
+    std::uint32_t low[Blocks], high[Blocks];
+    for (std::size_t j = 0; j < Blocks; j++) {
+        std::uint64_t index = block_index + j;
+        low[j] = (std::uint32_t)(index & 0xFFFFFFFF);
+        high[j] = schedule.state[11] ^ (std::uint32_t)((index >> 32) & 0xFFFFFFFF);
+    }
+
+    V s[16], x[16];
+    for (std::size_t i = 0; i < 16; i++) {
+        s[i] = O::set1(schedule.state[i]);
+        x[i] = O::set1(schedule.rows[i]);
+    }
+    s[10] = O::load(low);
+    s[11] = O::load(high);
+    x[8] = s[8]; x[9] = s[9]; x[10] = s[10]; x[11] = s[11];
+
+    detail::run<O, detail::round1>(x);
+    detail::add_state<O>(x, s, words);
+    detail::run<O, detail::round2>(x);
+    detail::add_state<O>(x, s, words);
+
+    // Lane j of word i goes to word i of block j
+    for (std::size_t i = 0; i < 16; i++) {
+        std::uint32_t word[Blocks];
+        O::store(x[i], word);
+        for (std::size_t j = 0; j < Blocks; j++) out[j * 16 + i] = word[j];
+    }
+}
+
+// Encrypt/decrypt like helix2_key_buffer, whole blocks go through the Blocks wide kernel
+template <std::size_t Blocks = 16>
+inline void key_buffer(const helix2_key_t& schedule, std::uint8_t* buffer, std::size_t size, std::uint64_t start_offset) {
+    std::uint32_t keystream[Blocks * 16];
+    std::uint64_t block = start_offset / HELIX2_KEYSTREAM_SIZE;
+    std::size_t block_offset = start_offset % HELIX2_KEYSTREAM_SIZE;
+
+    while (size > 0) {
+        std::size_t chunk;
+        if (block_offset == 0 && size >= Blocks * HELIX2_KEYSTREAM_SIZE) {
+            keystream_blocks<Blocks>(schedule, block, keystream);
+            chunk = Blocks * HELIX2_KEYSTREAM_SIZE;
+            block += Blocks;
+        } else {
+            keystream_blocks<1>(schedule, block, keystream);
+            chunk = HELIX2_KEYSTREAM_SIZE - block_offset;
+            if (chunk > size) chunk = size;
+            block++;
+        }
+
+        const std::uint8_t* keystream_bytes = (const std::uint8_t*)keystream + block_offset;
+        for (std::size_t i = 0; i < chunk; i++) buffer[i] ^= keystream_bytes[i];
+
+        buffer += chunk;
+        size -= chunk;
+        block_offset = 0;
+    }
+}
+
+} // namespace helix2
+
+#endif
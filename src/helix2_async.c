@@ -0,0 +1,254 @@
+/**
+ * @file helix2_async.c
+ * @brief Helix2 Stream Cipher, asynchronous bulk keystream jobs and offload devices
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _HELIX2_EXPORT
+#define _HELIX2_THREADS
+#include "helix2_internal.h"
+#include <stdlib.h>
+
+enum { _HELIX2_JOB_FREE, _HELIX2_JOB_QUEUED, _HELIX2_JOB_RUNNING, _HELIX2_JOB_DONE };
+
+// One submitted range, the schedule is copied so the caller's may change or go away after submit
+typedef struct
+{
+    helix2_key_t schedule;
+    uint8_t *dst;
+    const uint8_t *src;             // NULL for raw keystream
+    size_t size;
+    uint64_t start_offset;
+    helix2_ticket_t ticket;
+    int state;
+} _helix2_async_job_t;
+
+// Job ring, job t lives in slot t % depth until it is done and a later submit reuses the slot
+//   Workers take jobs in ticket order, but several workers may finish them out of order.
+struct helix2_async
+{
+    _helix2_lock_t lock;
+    _helix2_cond_t work;            // a job was queued, or stop
+    _helix2_cond_t done;            // a job finished
+    _helix2_async_job_t *jobs;
+    size_t depth;
+    helix2_ticket_t next;           // ticket of the next submit, tickets start at 1
+    helix2_ticket_t taken;          // next ticket a worker takes
+    size_t pending;                 // queued or running jobs
+    bool stop;
+    helix2_offload_t offload;
+    unsigned int threads;
+    _helix2_thread_t workers[HELIX2_PARALLEL_MAX_THREADS];
+};
+
+// Internal helper function declarations
+static bool _helix2_async_done(const helix2_async_t *async, helix2_ticket_t ticket);
+static void _helix2_async_run(helix2_async_t *async);
+static void _helix2_async_process(const helix2_async_t *async, _helix2_async_job_t *job);
+#ifdef _WIN32
+static DWORD WINAPI _helix2_async_thread(LPVOID arg);
+#else
+static void *_helix2_async_thread(void *arg);
+#endif
+
+// Exposed functions
+// Create an asynchronous queue with worker threads (0 = 1) and up to depth jobs in flight (0 = twice the threads)
+//   offload may be NULL, otherwise its process function gets every job first (see helix2_offload_t).
+//   Returns NULL when out of memory or if no worker thread could be started.
+HELIX2_API helix2_async_t* helix2_async_create(unsigned int threads, size_t depth, const helix2_offload_t* offload) {
+    if (threads == 0) threads = 1;
+    if (threads > HELIX2_PARALLEL_MAX_THREADS) threads = HELIX2_PARALLEL_MAX_THREADS;
+    if (depth == 0) depth = 2 * (size_t)threads;
+
+    helix2_async_t *async = (helix2_async_t *)calloc(1, sizeof(helix2_async_t));
+    if (async == NULL) return NULL;
+    async->jobs = (_helix2_async_job_t *)calloc(depth, sizeof(_helix2_async_job_t));
+    if (async->jobs == NULL) {
+        free(async);
+        return NULL;
+    }
+
+    async->depth = depth;
+    async->next = 1;
+    async->taken = 1;
+    if (offload != NULL) async->offload = *offload;
+    _helix2_lock_init(&async->lock);
+    _helix2_cond_init(&async->work);
+    _helix2_cond_init(&async->done);
+
+    for (unsigned int i = 0; i < threads; i++) {
+#ifdef _WIN32
+        async->workers[i] = CreateThread(NULL, 0, _helix2_async_thread, async, 0, NULL);
+        if (async->workers[i] == NULL) break;
+#else
+        if (pthread_create(&async->workers[i], NULL, _helix2_async_thread, async) != 0) break;
+#endif
+        async->threads++;
+    }
+    if (async->threads == 0) {
+        helix2_async_destroy(async);
+        return NULL;
+    }
+    return async;
+}
+
+// Queue dst = src ^ keystream (src NULL: raw keystream, src == dst: in place) for [start_offset, start_offset + size)
+//   Returns at once unless depth jobs are in flight, then it waits for a free slot.
+//   The buffers must stay valid and untouched until the job is done. Returns the job's ticket.
+HELIX2_API helix2_ticket_t helix2_async_submit(helix2_async_t* async, const helix2_key_t* schedule, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset) {
+    _helix2_lock_acquire(&async->lock);
+
+    _helix2_async_job_t *job = &async->jobs[async->next % async->depth];
+    while (job->state == _HELIX2_JOB_QUEUED || job->state == _HELIX2_JOB_RUNNING) {
+        _helix2_cond_wait(&async->done, &async->lock);
+    }
+
+    job->schedule = *schedule;
+    job->dst = dst;
+    job->src = src;
+    job->size = size;
+    job->start_offset = start_offset;
+    job->ticket = async->next++;
+    job->state = _HELIX2_JOB_QUEUED;
+    async->pending++;
+    helix2_ticket_t ticket = job->ticket;
+
+    _helix2_cond_notify(&async->work);
+    _helix2_lock_release(&async->lock);
+    return ticket;
+}
+
+// Has the job finished (tickets that were never handed out count as finished)
+HELIX2_API bool helix2_async_poll(helix2_async_t* async, helix2_ticket_t ticket) {
+    _helix2_lock_acquire(&async->lock);
+    bool done = _helix2_async_done(async, ticket);
+    _helix2_lock_release(&async->lock);
+    return done;
+}
+
+// Wait until the job has finished
+HELIX2_API void helix2_async_wait(helix2_async_t* async, helix2_ticket_t ticket) {
+    _helix2_lock_acquire(&async->lock);
+    while (!_helix2_async_done(async, ticket)) _helix2_cond_wait(&async->done, &async->lock);
+    _helix2_lock_release(&async->lock);
+}
+
+// Wait until every submitted job has finished
+HELIX2_API void helix2_async_drain(helix2_async_t* async) {
+    _helix2_lock_acquire(&async->lock);
+    while (async->pending > 0) _helix2_cond_wait(&async->done, &async->lock);
+    _helix2_lock_release(&async->lock);
+}
+
+// Finish all jobs, stop the workers and release the queue, the copied key schedules are wiped
+HELIX2_API void helix2_async_destroy(helix2_async_t* async) {
+    if (async == NULL) return;
+
+    helix2_async_drain(async);
+    _helix2_lock_acquire(&async->lock);
+    async->stop = true;
+    _helix2_cond_notify(&async->work);
+    _helix2_lock_release(&async->lock);
+
+    for (unsigned int i = 0; i < async->threads; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(async->workers[i], INFINITE);
+        CloseHandle(async->workers[i]);
+#else
+        pthread_join(async->workers[i], NULL);
+#endif
+    }
+
+    _helix2_cond_destroy(&async->done);
+    _helix2_cond_destroy(&async->work);
+    _helix2_lock_destroy(&async->lock);
+    memset(async->jobs, 0, async->depth * sizeof(_helix2_async_job_t));
+    free(async->jobs);
+    free(async);
+}
+
+
+// Internal helper functions
+// Job state check, called with the lock held
+//   A slot that holds a later ticket was reused, which only happens once its earlier job was done.
+static bool _helix2_async_done(const helix2_async_t *async, helix2_ticket_t ticket) {
+    if (ticket == 0 || ticket >= async->next) return true;
+
+    const _helix2_async_job_t *job = &async->jobs[ticket % async->depth];
+    return job->ticket > ticket || job->state == _HELIX2_JOB_DONE;
+}
+
+// Worker loop, takes jobs in ticket order until the queue stops
+static void _helix2_async_run(helix2_async_t *async) {
+    _helix2_lock_acquire(&async->lock);
+    for (;;) {
+        while (!async->stop && async->taken == async->next) _helix2_cond_wait(&async->work, &async->lock);
+        if (async->taken == async->next) break;
+
+        _helix2_async_job_t *job = &async->jobs[async->taken++ % async->depth];
+        job->state = _HELIX2_JOB_RUNNING;
+        _helix2_lock_release(&async->lock);
+
+        _helix2_async_process(async, job);
+
+        _helix2_lock_acquire(&async->lock);
+        job->state = _HELIX2_JOB_DONE;
+        async->pending--;
+        _helix2_cond_notify(&async->done);
+    }
+    _helix2_lock_release(&async->lock);
+}
+
+// Run one job on the offload device, or on this CPU thread when there is none or it declines
+static void _helix2_async_process(const helix2_async_t *async, _helix2_async_job_t *job) {
+    if (async->offload.process != NULL && async->offload.process(async->offload.device, &job->schedule, job->dst, job->src, job->size, job->start_offset)) {
+        return;
+    }
+
+    if (job->src == NULL) {
+        helix2_key_keystream(&job->schedule, job->dst, job->size, job->start_offset);
+    } else {
+        helix2_key_buffer_copy(&job->schedule, job->dst, job->src, job->size, job->start_offset);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI _helix2_async_thread(LPVOID arg) {
+    _helix2_async_run((helix2_async_t *)arg);
+    return 0;
+}
+#else
+static void *_helix2_async_thread(void *arg) {
+    _helix2_async_run((helix2_async_t *)arg);
+    return NULL;
+}
+#endif
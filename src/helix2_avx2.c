@@ -0,0 +1,118 @@
+/**
+ * @file helix2_avx2.c
+ * @brief Helix2 Stream Cipher, AVX2 multi-block keystream engine (8 blocks)
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "helix2_internal.h"
+
+#if defined(HELIX2_ARCH_X86)
+#if !defined(__AVX2__)
+    #error "helix2_avx2.c must be compiled with -mavx2"
+#endif
+#include <immintrin.h>
+
+#define _AVX2_ADD(a, b)  _mm256_add_epi32((a), (b))
+#define _AVX2_XOR(a, b)  _mm256_xor_si256((a), (b))
+#define _AVX2_ROTL(x, n) _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+
+// Transpose 4 rows of 4 words within each 128-bit half, the low half holds blocks 0-3, the high half blocks 4-7
+static inline void _avx2_transpose(__m256i *r) {
+    __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    __m256i t1 = _mm256_unpacklo_epi32(r[2], r[3]);
+    __m256i t2 = _mm256_unpackhi_epi32(r[0], r[1]);
+    __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+
+    r[0] = _mm256_unpacklo_epi64(t0, t1);
+    r[1] = _mm256_unpackhi_epi64(t0, t1);
+    r[2] = _mm256_unpacklo_epi64(t2, t3);
+    r[3] = _mm256_unpackhi_epi64(t2, t3);
+}
+
+// Store lane vectors as HELIX2_AVX2_BLOCKS blocks in block layout
+static inline void _avx2_store_blocks(const __m256i *x, uint32_t *out) {
+    for (int i = 0; i < 16; i += 4) {
+        __m256i r[4] = { x[i + 0], x[i + 1], x[i + 2], x[i + 3] };
+        _avx2_transpose(r);
+        for (int j = 0; j < 4; j++) {
+            _mm_storeu_si128((__m128i *)&out[j * 16 + i], _mm256_castsi256_si128(r[j]));
+            _mm_storeu_si128((__m128i *)&out[(j + 4) * 16 + i], _mm256_extracti128_si256(r[j], 1));
+        }
+    }
+}
+
+// Build HELIX2_AVX2_BLOCKS keystream blocks per iteration, lane j holds block_index + j
+void _helix2_keystream_avx2(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks) {
+    __m256i s[16], r[16], x[16];
+    uint32_t low[HELIX2_AVX2_BLOCKS], high[HELIX2_AVX2_BLOCKS];
+
+    for (int i = 0; i < 16; i++) {
+        s[i] = _mm256_set1_epi32((int)state[i]);
+        r[i] = _mm256_set1_epi32((int)rows[i]);
+    }
+
+    for (size_t n = 0; n < blocks; n += HELIX2_AVX2_BLOCKS, block_index += HELIX2_AVX2_BLOCKS) {
+        _HELIX2_COUNTERS(low, high, nonce_word, block_index, HELIX2_AVX2_BLOCKS);
+        s[10] = _mm256_loadu_si256((const __m256i *)low);
+        s[11] = _mm256_loadu_si256((const __m256i *)high);
+
+        // Start from the cached rows, only the counter row is shuffled per block
+        for (int i = 0; i < 16; i++) x[i] = r[i];
+        x[8] = s[8]; x[9] = s[9]; x[10] = s[10]; x[11] = s[11];
+        _HELIX2_ROUNDS_FROM_ROWS(__m256i, x, s, _AVX2_ADD, _AVX2_XOR, _AVX2_ROTL);
+
+        _avx2_store_blocks(x, &out[n * 16]);
+    }
+}
+
+// Build HELIX2_AVX2_BLOCKS keystream blocks from independent block states, lane j runs states[j * 16 ..]
+void _helix2_lanes_avx2(const uint32_t *states, uint32_t *out) {
+    __m256i s[16], x[16];
+
+    for (int i = 0; i < 16; i += 4) {
+        __m256i r[4];
+        for (int j = 0; j < 4; j++) {
+            __m128i low = _mm_loadu_si128((const __m128i *)&states[j * 16 + i]);
+            __m128i high = _mm_loadu_si128((const __m128i *)&states[(j + 4) * 16 + i]);
+            r[j] = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        }
+        _avx2_transpose(r);
+        for (int j = 0; j < 4; j++) s[i + j] = r[j];
+    }
+
+    for (int i = 0; i < 16; i++) x[i] = s[i];
+    _HELIX2_ROUNDS(__m256i, x, s, _AVX2_ADD, _AVX2_XOR, _AVX2_ROTL);
+
+    _avx2_store_blocks(x, out);
+}
+
+#endif
@@ -0,0 +1,121 @@
+/**
+ * @file helix2_avx512.c
+ * @brief Helix2 Stream Cipher, AVX-512 multi-block keystream engine (16 blocks)
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "helix2_internal.h"
+
+#if defined(HELIX2_ARCH_X86)
+#if !defined(__AVX512F__)
+    #error "helix2_avx512.c must be compiled with -mavx512f"
+#endif
+#include <immintrin.h>
+
+#define _AVX512_ADD(a, b)  _mm512_add_epi32((a), (b))
+#define _AVX512_XOR(a, b)  _mm512_xor_si512((a), (b))
+#define _AVX512_ROTL(x, n) _mm512_rol_epi32((x), (n))
+
+// Transpose 4 rows of 4 words within each 128-bit quarter, quarter k holds blocks 4k to 4k+3
+static inline void _avx512_transpose(__m512i *r) {
+    __m512i t0 = _mm512_unpacklo_epi32(r[0], r[1]);
+    __m512i t1 = _mm512_unpacklo_epi32(r[2], r[3]);
+    __m512i t2 = _mm512_unpackhi_epi32(r[0], r[1]);
+    __m512i t3 = _mm512_unpackhi_epi32(r[2], r[3]);
+
+    r[0] = _mm512_unpacklo_epi64(t0, t1);
+    r[1] = _mm512_unpackhi_epi64(t0, t1);
+    r[2] = _mm512_unpacklo_epi64(t2, t3);
+    r[3] = _mm512_unpackhi_epi64(t2, t3);
+}
+
+// Store lane vectors as HELIX2_AVX512_BLOCKS blocks in block layout
+static inline void _avx512_store_blocks(const __m512i *x, uint32_t *out) {
+    for (int i = 0; i < 16; i += 4) {
+        __m512i r[4] = { x[i + 0], x[i + 1], x[i + 2], x[i + 3] };
+        _avx512_transpose(r);
+        for (int j = 0; j < 4; j++) {
+            _mm_storeu_si128((__m128i *)&out[(j + 0)  * 16 + i], _mm512_extracti32x4_epi32(r[j], 0));
+            _mm_storeu_si128((__m128i *)&out[(j + 4)  * 16 + i], _mm512_extracti32x4_epi32(r[j], 1));
+            _mm_storeu_si128((__m128i *)&out[(j + 8)  * 16 + i], _mm512_extracti32x4_epi32(r[j], 2));
+            _mm_storeu_si128((__m128i *)&out[(j + 12) * 16 + i], _mm512_extracti32x4_epi32(r[j], 3));
+        }
+    }
+}
+
+// Build HELIX2_AVX512_BLOCKS keystream blocks per iteration, lane j holds block_index + j
+void _helix2_keystream_avx512(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks) {
+    __m512i s[16], r[16], x[16];
+    uint32_t low[HELIX2_AVX512_BLOCKS], high[HELIX2_AVX512_BLOCKS];
+
+    for (int i = 0; i < 16; i++) {
+        s[i] = _mm512_set1_epi32((int)state[i]);
+        r[i] = _mm512_set1_epi32((int)rows[i]);
+    }
+
+    for (size_t n = 0; n < blocks; n += HELIX2_AVX512_BLOCKS, block_index += HELIX2_AVX512_BLOCKS) {
+        _HELIX2_COUNTERS(low, high, nonce_word, block_index, HELIX2_AVX512_BLOCKS);
+        s[10] = _mm512_loadu_si512((const void *)low);
+        s[11] = _mm512_loadu_si512((const void *)high);
+
+        // Start from the cached rows, only the counter row is shuffled per block
+        for (int i = 0; i < 16; i++) x[i] = r[i];
+        x[8] = s[8]; x[9] = s[9]; x[10] = s[10]; x[11] = s[11];
+        _HELIX2_ROUNDS_FROM_ROWS(__m512i, x, s, _AVX512_ADD, _AVX512_XOR, _AVX512_ROTL);
+
+        _avx512_store_blocks(x, &out[n * 16]);
+    }
+}
+
+// Build HELIX2_AVX512_BLOCKS keystream blocks from independent block states, lane j runs states[j * 16 ..]
+void _helix2_lanes_avx512(const uint32_t *states, uint32_t *out) {
+    __m512i s[16], x[16];
+
+    for (int i = 0; i < 16; i += 4) {
+        __m512i r[4];
+        for (int j = 0; j < 4; j++) {
+            r[j] = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i *)&states[(j + 0) * 16 + i]));
+            r[j] = _mm512_inserti32x4(r[j], _mm_loadu_si128((const __m128i *)&states[(j + 4)  * 16 + i]), 1);
+            r[j] = _mm512_inserti32x4(r[j], _mm_loadu_si128((const __m128i *)&states[(j + 8)  * 16 + i]), 2);
+            r[j] = _mm512_inserti32x4(r[j], _mm_loadu_si128((const __m128i *)&states[(j + 12) * 16 + i]), 3);
+        }
+        _avx512_transpose(r);
+        for (int j = 0; j < 4; j++) s[i + j] = r[j];
+    }
+
+    for (int i = 0; i < 16; i++) x[i] = s[i];
+    _HELIX2_ROUNDS(__m512i, x, s, _AVX512_ADD, _AVX512_XOR, _AVX512_ROTL);
+
+    _avx512_store_blocks(x, out);
+}
+
+#endif
@@ -0,0 +1,218 @@
+/**
+ * @file helix2_cache.c
+ * @brief Helix2 Stream Cipher, keystream page cache for repeated random access
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _HELIX2_EXPORT
+#include "helix2_internal.h"
+#include <stdlib.h>
+
+#define _HELIX2_CACHE_BLOCKS  (HELIX2_CACHE_PAGE / HELIX2_KEYSTREAM_SIZE)
+#define _HELIX2_CACHE_EMPTY   UINT32_MAX
+
+// Keystream cache, pages of HELIX2_CACHE_PAGE bytes found through an open addressing table (linear probing)
+//   and replaced in CLOCK order: the hand clears reference bits until it finds a page not used since its last visit.
+struct helix2_cache
+{
+    helix2_key_t schedule;
+    size_t pages;                   // slots
+    size_t used;                    // slots filled so far, they fill in order before the hand starts evicting
+    size_t hand;
+    uint8_t *data;                  // pages * HELIX2_CACHE_PAGE bytes, cache line aligned
+    uint64_t *page_index;           // keystream page held by each slot
+    uint8_t *referenced;
+    uint32_t *table;                // slot numbers, _HELIX2_CACHE_EMPTY for free entries
+    size_t table_mask;
+    helix2_cache_stats_t stats;
+    void *allocation;
+};
+
+// Internal helper function declarations
+static size_t _helix2_cache_home(const helix2_cache_t *cache, uint64_t page);
+static uint32_t _helix2_cache_find(const helix2_cache_t *cache, uint64_t page);
+static void _helix2_cache_insert(helix2_cache_t *cache, uint64_t page, uint32_t slot);
+static void _helix2_cache_remove(helix2_cache_t *cache, uint64_t page);
+static uint32_t _helix2_cache_page(helix2_cache_t *cache, uint64_t page);
+
+// Exposed functions
+// Create a keystream cache of capacity bytes (rounded down to whole pages, at least one) for a key schedule
+//   The schedule is copied. Not thread-safe, use one cache per thread or a lock. Returns NULL when out of memory.
+HELIX2_API helix2_cache_t* helix2_cache_create(const helix2_key_t* schedule, size_t capacity) {
+    size_t pages = capacity / HELIX2_CACHE_PAGE;
+    if (pages == 0) pages = 1;
+    if (pages > UINT32_MAX / 2 || pages > SIZE_MAX / 2 / HELIX2_CACHE_PAGE) return NULL;
+
+    size_t table = 1;
+    while (table < 2 * pages) table *= 2;       // at most half full, probes stay short
+
+    // One allocation: struct, page data, slot arrays and table
+    size_t header = (sizeof(helix2_cache_t) + HELIX2_CACHE_LINE - 1) / HELIX2_CACHE_LINE * HELIX2_CACHE_LINE;
+    size_t size = header + pages * HELIX2_CACHE_PAGE + pages * sizeof(uint64_t) + table * sizeof(uint32_t) + pages;
+    void *allocation = calloc(1, size + HELIX2_CACHE_LINE - 1);
+    if (allocation == NULL) return NULL;
+
+    uint8_t *aligned = (uint8_t *)(((uintptr_t)allocation + HELIX2_CACHE_LINE - 1) & ~(uintptr_t)(HELIX2_CACHE_LINE - 1));
+    helix2_cache_t *cache = (helix2_cache_t *)aligned;
+    cache->allocation = allocation;
+    cache->schedule = *schedule;
+    cache->pages = pages;
+    cache->data = aligned + header;
+    cache->page_index = (uint64_t *)(cache->data + pages * HELIX2_CACHE_PAGE);
+    cache->table = (uint32_t *)(cache->page_index + pages);
+    cache->referenced = (uint8_t *)(cache->table + table);
+    cache->table_mask = table - 1;
+    for (size_t i = 0; i < table; i++) cache->table[i] = _HELIX2_CACHE_EMPTY;
+    cache->stats.capacity = pages * HELIX2_CACHE_PAGE;
+    return cache;
+}
+
+// Encrypt/Decrypt a buffer starting at keystream offset start_offset, same result as helix2_key_buffer
+//   Pages of keystream are kept for later calls, a range at least as large as the whole cache bypasses it
+//   instead of evicting everything.
+HELIX2_API void helix2_cache_buffer(helix2_cache_t* cache, uint8_t* buffer, size_t size, uint64_t start_offset) {
+    if (size >= cache->stats.capacity) {
+        cache->stats.bypassed_bytes += size;
+        helix2_key_buffer(&cache->schedule, buffer, size, start_offset);
+        return;
+    }
+    _HELIX2_STATS_CALL(size);
+
+    uint64_t page = start_offset / HELIX2_CACHE_PAGE;
+    size_t page_offset = (size_t)(start_offset % HELIX2_CACHE_PAGE);
+
+    while (size > 0) {
+        size_t chunk = HELIX2_CACHE_PAGE - page_offset;
+        if (chunk > size) chunk = size;
+
+        uint32_t slot = _helix2_cache_page(cache, page);
+        _helix2_xor(buffer, buffer, &cache->data[(size_t)slot * HELIX2_CACHE_PAGE + page_offset], chunk);
+
+        buffer += chunk;
+        size -= chunk;
+        page++;
+        page_offset = 0;
+    }
+}
+
+// Hit, miss and eviction counters of a cache
+HELIX2_API void helix2_cache_get_stats(const helix2_cache_t* cache, helix2_cache_stats_t* stats) {
+    *stats = cache->stats;
+    stats->cached_bytes = (uint64_t)cache->used * HELIX2_CACHE_PAGE;
+}
+
+// Release a cache, the keystream and key schedule are wiped
+HELIX2_API void helix2_cache_destroy(helix2_cache_t* cache) {
+    if (cache == NULL) return;
+
+    void *allocation = cache->allocation;
+    memset(cache->data, 0, cache->pages * HELIX2_CACHE_PAGE);
+    memset(&cache->schedule, 0, sizeof(cache->schedule));
+    free(allocation);
+}
+
+
+// Internal helper functions
+// Slot holding a keystream page, generated into a free or evicted slot on a miss
+static uint32_t _helix2_cache_page(helix2_cache_t *cache, uint64_t page) {
+    uint32_t slot = _helix2_cache_find(cache, page);
+    if (slot != _HELIX2_CACHE_EMPTY) {
+        cache->referenced[slot] = 1;
+        cache->stats.hits++;
+        return slot;
+    }
+    cache->stats.misses++;
+
+    if (cache->used < cache->pages) {
+        slot = (uint32_t)cache->used++;
+    } else {
+        while (cache->referenced[cache->hand]) {
+            cache->referenced[cache->hand] = 0;
+            cache->hand = (cache->hand + 1) % cache->pages;
+        }
+        slot = (uint32_t)cache->hand;
+        cache->hand = (cache->hand + 1) % cache->pages;
+        _helix2_cache_remove(cache, cache->page_index[slot]);
+        cache->stats.evictions++;
+    }
+
+    // A page is 64 blocks, whole batches for every engine
+    uint32_t *out = (uint32_t *)&cache->data[(size_t)slot * HELIX2_CACHE_PAGE];
+    uint64_t block = page * _HELIX2_CACHE_BLOCKS;
+    for (size_t done = 0; done < _HELIX2_CACHE_BLOCKS; ) {
+        const _helix2_engine_t *engine = _helix2_get_engine_for(_HELIX2_CACHE_BLOCKS - done);
+        size_t blocks = (_HELIX2_CACHE_BLOCKS - done) / engine->blocks * engine->blocks;
+        if (blocks > HELIX2_MAX_BLOCKS) blocks = HELIX2_MAX_BLOCKS;
+        engine->keystream(cache->schedule.state, cache->schedule.rows, cache->schedule.state[11], block + done, &out[done * 16], blocks);
+        _HELIX2_STATS_BLOCKS(engine->backend, blocks);
+        done += blocks;
+    }
+
+    cache->page_index[slot] = page;
+    cache->referenced[slot] = 0;            // set by the next hit, a page read once goes first
+    _helix2_cache_insert(cache, page, slot);
+    return slot;
+}
+
+// First table entry to probe for a page (Fibonacci hashing)
+static size_t _helix2_cache_home(const helix2_cache_t *cache, uint64_t page) {
+    return (size_t)((page * 0x9E3779B97F4A7C15ull) >> 32) & cache->table_mask;
+}
+
+static uint32_t _helix2_cache_find(const helix2_cache_t *cache, uint64_t page) {
+    for (size_t i = _helix2_cache_home(cache, page); ; i = (i + 1) & cache->table_mask) {
+        uint32_t slot = cache->table[i];
+        if (slot == _HELIX2_CACHE_EMPTY || cache->page_index[slot] == page) return slot;
+    }
+}
+
+static void _helix2_cache_insert(helix2_cache_t *cache, uint64_t page, uint32_t slot) {
+    size_t i = _helix2_cache_home(cache, page);
+    while (cache->table[i] != _HELIX2_CACHE_EMPTY) i = (i + 1) & cache->table_mask;
+    cache->table[i] = slot;
+}
+
+// Remove a page and shift the entries behind it back, so no probe sequence is broken (no tombstones)
+static void _helix2_cache_remove(helix2_cache_t *cache, uint64_t page) {
+    size_t i = _helix2_cache_home(cache, page);
+    while (cache->page_index[cache->table[i]] != page) i = (i + 1) & cache->table_mask;
+
+    for (size_t j = (i + 1) & cache->table_mask; cache->table[j] != _HELIX2_CACHE_EMPTY; j = (j + 1) & cache->table_mask) {
+        // Entry j can move to the hole at i if its home is not in (i, j] (cyclically)
+        size_t home = _helix2_cache_home(cache, cache->page_index[cache->table[j]]);
+        if (((j - home) & cache->table_mask) >= ((j - i) & cache->table_mask)) {
+            cache->table[i] = cache->table[j];
+            i = j;
+        }
+    }
+    cache->table[i] = _HELIX2_CACHE_EMPTY;
+}
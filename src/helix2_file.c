@@ -0,0 +1,103 @@
+/**
+ * @file helix2_file.c
+ * @brief Helix2 Stream Cipher, random access decryption of encrypted files
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+    #define _DEFAULT_SOURCE     // pread
+#endif
+#if !defined(_WIN32) && !defined(_FILE_OFFSET_BITS)
+    #define _FILE_OFFSET_BITS 64
+#endif
+
+#define _HELIX2_EXPORT
+#include "helix2_internal.h"
+
+#include <errno.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+// Internal helper function declarations
+static int64_t _helix2_pread(int fd, uint8_t *buffer, size_t size, uint64_t offset);
+
+// Exposed functions
+// Read size bytes at offset of an encrypted file and decrypt them, thread-safe like helix2_key_buffer
+//   The file is expected to be encrypted from keystream offset 0 (like helix2_cl does), so the file offset
+//   is the keystream offset and only the blocks covering [offset, offset + size) are generated.
+//   The file position of fd is not used or moved (on POSIX), so threads can share one descriptor.
+//   Returns the number of bytes read and decrypted, less than size at the end of the file, or -1 on error.
+HELIX2_API int64_t helix2_key_pread(const helix2_key_t* schedule, int fd, uint8_t* buffer, size_t size, uint64_t offset) {
+    int64_t count = _helix2_pread(fd, buffer, size, offset);
+    if (count > 0) helix2_key_buffer(schedule, buffer, (size_t)count, offset);
+    return count;
+}
+
+
+// Internal helper functions
+// Positioned read until size bytes or the end of the file
+static int64_t _helix2_pread(int fd, uint8_t *buffer, size_t size, uint64_t offset) {
+    size_t total = 0;
+#ifdef _WIN32
+    HANDLE handle = (HANDLE)_get_osfhandle(fd);
+    if (handle == INVALID_HANDLE_VALUE) return -1;
+#endif
+
+    while (total < size) {
+        uint64_t position = offset + total;
+#ifdef _WIN32
+        OVERLAPPED at;
+        memset(&at, 0, sizeof(at));
+        at.Offset = (DWORD)position;
+        at.OffsetHigh = (DWORD)(position >> 32);
+
+        DWORD request = size - total > 0x40000000 ? 0x40000000 : (DWORD)(size - total);
+        DWORD count;
+        if (!ReadFile(handle, &buffer[total], request, &count, &at)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) break;
+            return -1;
+        }
+#else
+        ssize_t count = pread(fd, &buffer[total], size - total, (off_t)position);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return -1;
+#endif
+        if (count == 0) break;
+        total += (size_t)count;
+    }
+    return (int64_t)total;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file helix2_inline.h
+ * @brief Helix2 Stream Cipher, optional header-only inline single-block and small-buffer paths
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HELIX2_INCL_INLINE_H
+#define HELIX2_INCL_INLINE_H
+
+// Optional header-only single-block and small-buffer paths, for callers that want the hot code in their own loops
+//   Every function produces the same keystream (and leaves a context in the same state) as its library counterpart.
+//   Buffers shorter than HELIX2_INLINE_MAX run the scalar block function inlined here, longer ones call the library,
+//   whose multi-block engines are faster there. Inlined calls are not seen by the make STATS=1 counters.
+
+#include "helix2.h"
+#include "helix2_rounds.h"
+
+#ifndef HELIX2_INLINE_MAX
+    #define HELIX2_INLINE_MAX (4 * HELIX2_KEYSTREAM_SIZE)     // from here the SSE2 engine has a whole batch
+#endif
+
+// Internal helper functions
+// One keystream block at block_index, from the packed state and cached round 1 rows (helix2_key_t / helix2_context_t)
+static inline void _helix2_inline_block(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *stream) {
+    uint32_t block_state[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    memcpy(block_state, state, HELIX2_KEYSTREAM_SIZE);
+    block_state[10] = (uint32_t)(block_index & 0xFFFFFFFF);
+    block_state[11] = nonce_word ^ (uint32_t)((block_index >> 32) & 0xFFFFFFFF);
+
+    _helix2_rounds_block(block_state, rows, stream);
+}
+
+static inline void _helix2_inline_xor(uint8_t *dst, const uint8_t *src, const uint8_t *keystream, size_t size) {
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t data, key;
+        memcpy(&data, &src[i], sizeof(data));
+        memcpy(&key, &keystream[i], sizeof(key));
+        data ^= key;
+        memcpy(&dst[i], &data, sizeof(data));
+    }
+    for (; i < size; i++) dst[i] = src[i] ^ keystream[i];
+}
+
+// dst = src ^ keystream for a short buffer, one block at a time like the partial block paths of _helix2_process
+//   stream ends up holding the last block used (also for size 0), returns its block index.
+static inline uint64_t _helix2_inline_process(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint8_t *dst, const uint8_t *src, size_t size, uint64_t start_offset, uint32_t *stream) {
+    uint64_t block = start_offset / HELIX2_KEYSTREAM_SIZE;
+    size_t block_offset = (size_t)(start_offset % HELIX2_KEYSTREAM_SIZE);
+
+    do {
+        size_t chunk = HELIX2_KEYSTREAM_SIZE - block_offset;
+        if (chunk > size) chunk = size;
+
+        _helix2_inline_block(state, rows, nonce_word, block, stream);
+        _helix2_inline_xor(dst, src, (const uint8_t *)stream + block_offset, chunk);
+
+        dst += chunk;
+        src += chunk;
+        size -= chunk;
+        block++;
+        block_offset = 0;
+    } while (size > 0);
+
+    return block - 1;
+}
+
+// Exposed functions
+// One 64-byte keystream block of a key schedule, the bytes helix2_key_keystream writes at block_index * 64
+static inline void helix2_inline_key_block(const helix2_key_t* schedule, uint64_t block_index, uint8_t* out) {
+    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    _helix2_inline_block(schedule->state, schedule->rows, schedule->state[11], block_index, stream);
+    memcpy(out, stream, HELIX2_KEYSTREAM_SIZE);
+}
+
+// helix2_key_buffer_copy, inlined for short buffers (dst may equal src)
+static inline void helix2_inline_key_buffer_copy(const helix2_key_t* schedule, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset) {
+    if (size >= HELIX2_INLINE_MAX) {
+        helix2_key_buffer_copy(schedule, dst, src, size, start_offset);
+        return;
+    }
+    uint32_t stream[HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    _helix2_inline_process(schedule->state, schedule->rows, schedule->state[11], dst, src, size, start_offset, stream);
+}
+
+// helix2_key_buffer, inlined for short buffers
+static inline void helix2_inline_key_buffer(const helix2_key_t* schedule, uint8_t* buffer, size_t size, uint64_t start_offset) {
+    helix2_inline_key_buffer_copy(schedule, buffer, buffer, size, start_offset);
+}
+
+// helix2_buffer_copy, inlined for short buffers, the context keeps the last block and its index like the library does
+static inline void helix2_inline_buffer_copy(helix2_context_t* context, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset) {
+    if (size >= HELIX2_INLINE_MAX) {
+        helix2_buffer_copy(context, dst, src, size, start_offset);
+        return;
+    }
+    uint32_t nonce_word = context->nonce_word;
+    uint64_t last_block = _helix2_inline_process(context->state, context->rows, nonce_word, dst, src, size, start_offset, context->stream);
+
+    context->state[10] = (uint32_t)(last_block & 0xFFFFFFFF);
+    context->state[11] = nonce_word ^ (uint32_t)((last_block >> 32) & 0xFFFFFFFF);
+}
+
+// helix2_buffer, inlined for short buffers
+static inline void helix2_inline_buffer(helix2_context_t* context, uint8_t* buffer, size_t size, uint64_t start_offset) {
+    helix2_inline_buffer_copy(context, buffer, buffer, size, start_offset);
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef HELIX2_INTERNAL_INCL_H
+#define HELIX2_INTERNAL_INCL_H
+
+#include "helix2.h"
+#include "helix2_rounds.h"
+
+// Output modes of the buffer core
+#define _HELIX2_OUTPUT_XOR           0      // dst = src ^ keystream
+#define _HELIX2_OUTPUT_KEYSTREAM     1      // dst = keystream
+#define _HELIX2_OUTPUT_KEYSTREAM_NT  2      // dst = keystream, non-temporal stores
+#define HELIX2_NONTEMPORAL_MIN       (8 * 1024 * 1024)     // raw keystream outputs from this size bypass the cache
+#define HELIX2_BATCH_DIRECT_MIN      (HELIX2_MAX_BLOCKS * HELIX2_KEYSTREAM_SIZE)   // batch messages this long fill the engines on their own
+
+// Parallel processing (helix2_parallel.c)
+#define HELIX2_PARALLEL_GRAIN        (HELIX2_MAX_BLOCKS * HELIX2_KEYSTREAM_SIZE)   // chunks hold whole engine batches
+#define HELIX2_PARALLEL_MIN_CHUNK    (64 * 1024)                                   // smaller chunks cost more in thread start-up than they save
+#define HELIX2_PARALLEL_POOL_CHUNK   (1024 * 1024)                                 // chunk size handed to caller thread pools
+#define HELIX2_PARALLEL_MAX_THREADS  256
+
+// Target architecture, decides which multi-block engines are built into the library
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define HELIX2_ARCH_X86
+#elif defined(__aarch64__) || defined(__arm__) || defined(_M_ARM64)
+    #define HELIX2_ARCH_ARM
+#endif
+
+// Number of blocks each multi-block keystream engine computes in parallel
+#define HELIX2_SSE2_BLOCKS    4
+#define HELIX2_AVX2_BLOCKS    8
+#define HELIX2_AVX512_BLOCKS  16
+#define HELIX2_NEON_BLOCKS    4
+#define HELIX2_MAX_BLOCKS     16
+
+// Keystream engines (the scalar one, and multi-block ones with one block per vector lane, ChaCha-style word slicing)
+//   Builds `blocks` consecutive keystream blocks starting at block_index into out, 16 words per block.
+//   state is the packed context state, state[10] and state[11] are replaced per block by the counter words,
+//   rows is the state after the round 1 row shuffles that do not read the counter (see _HELIX2_FIXED_ROWS),
+//   nonce_word is the packed nonce[0..3] that the high counter bits are XORed into.
+//   blocks must be a multiple of the engine width.
+//   Each multi-block engine lives in its own file, compiled with the instruction set flags it needs,
+//   and is only called after runtime CPU detection selected it.
+//   The lanes variant builds exactly `width` blocks from independent 16-word block states (counter words included),
+//   states holds one block state per lane in block layout, used for batches of unrelated blocks.
+typedef void (*_helix2_keystream_fn)(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks);
+typedef void (*_helix2_lanes_fn)(const uint32_t *states, uint32_t *out);
+
+typedef struct
+{
+    helix2_backend_t backend;
+    size_t blocks;                  // engine width, blocks per parallel batch
+    _helix2_keystream_fn keystream;
+    _helix2_lanes_fn lanes;
+} _helix2_engine_t;
+
+// Context helpers shared by the library files
+void _helix2_initialize_keystream(helix2_context_t* context, uint64_t block_index);
+void _helix2_context_key(const helix2_context_t* context, helix2_key_t* schedule);
+
+const _helix2_engine_t *_helix2_get_engine(void);
+const _helix2_engine_t *_helix2_get_engine_for(size_t blocks);
+
+void _helix2_keystream_scalar(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks);
+void _helix2_lanes_scalar(const uint32_t *states, uint32_t *out);
+#if defined(HELIX2_ARCH_X86)
+void _helix2_keystream_sse2(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks);
+void _helix2_lanes_sse2(const uint32_t *states, uint32_t *out);
+void _helix2_keystream_avx2(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks);
+void _helix2_lanes_avx2(const uint32_t *states, uint32_t *out);
+void _helix2_keystream_avx512(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks);
+void _helix2_lanes_avx512(const uint32_t *states, uint32_t *out);
+
+// Non-temporal copy for large keystream outputs (SSE2), fence once after the last copy
+void _helix2_stream_copy_sse2(uint8_t *dst, const uint8_t *src, size_t size);
+void _helix2_stream_fence_sse2(void);
+#elif defined(HELIX2_ARCH_ARM)
+void _helix2_keystream_neon(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks);
+void _helix2_lanes_neon(const uint32_t *states, uint32_t *out);
+#endif
+
+// XOR size bytes of keystream into dst (dst = src ^ keystream), 64 bits at a time
+//   memcpy keeps the 64-bit loads and stores safe for unaligned buffers, the compiler turns them into plain moves.
+static inline void _helix2_xor(uint8_t *dst, const uint8_t *src, const uint8_t *keystream, size_t size) {
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t data, key;
+        memcpy(&data, &src[i], sizeof(uint64_t));
+        memcpy(&key, &keystream[i], sizeof(uint64_t));
+        data ^= key;
+        memcpy(&dst[i], &data, sizeof(uint64_t));
+    }
+    for (; i < size; i++) {
+        dst[i] = src[i] ^ keystream[i];
+    }
+}
+
+// Minimal thread, lock and condition wrappers for the files that define _HELIX2_THREADS before this header,
+//   the same as the helix2_cl pipeline uses. The others never see windows.h or pthread.h.
+#if defined(_HELIX2_THREADS)
+#ifdef _WIN32
+    #include <windows.h>
+    typedef HANDLE _helix2_thread_t;
+    typedef CRITICAL_SECTION _helix2_lock_t;
+    typedef CONDITION_VARIABLE _helix2_cond_t;
+    #define _helix2_lock_init(l)    InitializeCriticalSection(l)
+    #define _helix2_lock_destroy(l) DeleteCriticalSection(l)
+    #define _helix2_lock_acquire(l) EnterCriticalSection(l)
+    #define _helix2_lock_release(l) LeaveCriticalSection(l)
+    #define _helix2_cond_init(c)    InitializeConditionVariable(c)
+    #define _helix2_cond_destroy(c) ((void)(c))
+    #define _helix2_cond_wait(c, l) SleepConditionVariableCS((c), (l), INFINITE)
+    #define _helix2_cond_notify(c)  WakeAllConditionVariable(c)
+#else
+    #include <pthread.h>
+    typedef pthread_t _helix2_thread_t;
+    typedef pthread_mutex_t _helix2_lock_t;
+    typedef pthread_cond_t _helix2_cond_t;
+    #define _helix2_lock_init(l)    pthread_mutex_init((l), NULL)
+    #define _helix2_lock_destroy(l) pthread_mutex_destroy(l)
+    #define _helix2_lock_acquire(l) pthread_mutex_lock(l)
+    #define _helix2_lock_release(l) pthread_mutex_unlock(l)
+    #define _helix2_cond_init(c)    pthread_cond_init((c), NULL)
+    #define _helix2_cond_destroy(c) pthread_cond_destroy(c)
+    #define _helix2_cond_wait(c, l) pthread_cond_wait((c), (l))
+    #define _helix2_cond_notify(c)  pthread_cond_broadcast(c)
+#endif
+#endif
+
+// Hot path counters (helix2_stats.c), the _HELIX2_STATS_* macros compile to nothing without HELIX2_STATS
+//   Only the owning thread writes a slot, so the counters use relaxed loads and stores instead of atomic read-modify-writes,
+//   helix2_get_stats reads them from any thread.
+#if defined(HELIX2_STATS)
+#include <stdatomic.h>
+
+typedef struct _helix2_stats_slot
+{
+    _Atomic uint64_t calls;
+    _Atomic uint64_t bytes;
+    _Atomic uint64_t blocks;
+    _Atomic uint64_t partial_blocks;
+    _Atomic uint64_t backend_blocks[HELIX2_BACKEND_COUNT];
+    _Atomic uint64_t size_histogram[HELIX2_STATS_BUCKETS];
+    atomic_bool in_use;                         // owned by a running thread
+    struct _helix2_stats_slot *next;            // all slots, never unlinked
+} _helix2_stats_slot_t;
+
+extern _Thread_local _helix2_stats_slot_t *_helix2_stats_local;
+_helix2_stats_slot_t *_helix2_stats_register(void);
+
+static inline _helix2_stats_slot_t *_helix2_stats_slot(void) {
+    _helix2_stats_slot_t *slot = _helix2_stats_local;
+    return slot != NULL ? slot : _helix2_stats_register();
+}
+
+static inline void _helix2_stats_add(_Atomic uint64_t *counter, uint64_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+// One call of size bytes, its bytes included
+static inline void _helix2_stats_call(size_t size) {
+    _helix2_stats_slot_t *slot = _helix2_stats_slot();
+    _helix2_stats_add(&slot->bytes, size);
+
+    size_t bucket = 0;
+    while (size > 1 && bucket < HELIX2_STATS_BUCKETS - 1) {
+        size >>= 1;
+        bucket++;
+    }
+    _helix2_stats_add(&slot->calls, 1);
+    _helix2_stats_add(&slot->size_histogram[bucket], 1);
+}
+
+static inline void _helix2_stats_blocks(helix2_backend_t backend, size_t blocks) {
+    _helix2_stats_slot_t *slot = _helix2_stats_slot();
+    _helix2_stats_add(&slot->blocks, blocks);
+    _helix2_stats_add(&slot->backend_blocks[backend], blocks);
+}
+
+#define _HELIX2_STATS_CALL(size)               _helix2_stats_call(size)                                    // a call, its bytes included
+#define _HELIX2_STATS_BYTES(size)              _helix2_stats_add(&_helix2_stats_slot()->bytes, (size))     // bytes from keystream already counted
+#define _HELIX2_STATS_BLOCKS(backend, blocks)  _helix2_stats_blocks((backend), (blocks))
+#define _HELIX2_STATS_PARTIAL(blocks)          _helix2_stats_add(&_helix2_stats_slot()->partial_blocks, (blocks))
+#else
+#define _HELIX2_STATS_CALL(size)               ((void)0)
+#define _HELIX2_STATS_BYTES(size)              ((void)0)
+#define _HELIX2_STATS_BLOCKS(backend, blocks)  ((void)0)
+#define _HELIX2_STATS_PARTIAL(blocks)          ((void)0)
+#endif
+
+// Per-block counter words for `lanes` consecutive blocks, matching _helix2_initialize_keystream
+#define _HELIX2_COUNTERS(low, high, nonce_word, block_index, lanes) do {          \
+        for (int _j = 0; _j < (lanes); _j++) {                                      \
+            uint64_t _index = (block_index) + (uint64_t)_j;                         \
+            (low)[_j] = (uint32_t)(_index & 0xFFFFFFFF);                            \
+            (high)[_j] = (nonce_word) ^ (uint32_t)((_index >> 32) & 0xFFFFFFFF);    \
+        }                                                                           \
+    } while (0)
+
+#endif
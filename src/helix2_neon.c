@@ -0,0 +1,109 @@
+/**
+ * @file helix2_neon.c
+ * @brief Helix2 Stream Cipher, ARM NEON multi-block keystream engine (4 blocks)
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "helix2_internal.h"
+
+#if defined(HELIX2_ARCH_ARM)
+#if !(defined(__ARM_NEON) || defined(__ARM_NEON__))
+    #error "helix2_neon.c must be compiled with -mfpu=neon"
+#endif
+#include <arm_neon.h>
+
+#define _NEON_ADD(a, b)  vaddq_u32((a), (b))
+#define _NEON_XOR(a, b)  veorq_u32((a), (b))
+#define _NEON_ROTL(x, n) vsriq_n_u32(vshlq_n_u32((x), (n)), (x), 32 - (n))
+
+// Transpose 4 rows of 4 words, turns 4 words of 4 blocks into 4 lane vectors and back
+static inline void _neon_transpose(uint32x4_t *r) {
+    uint32x4x2_t t01 = vtrnq_u32(r[0], r[1]);
+    uint32x4x2_t t23 = vtrnq_u32(r[2], r[3]);
+
+    r[0] = vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0]));
+    r[1] = vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1]));
+    r[2] = vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0]));
+    r[3] = vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1]));
+}
+
+// Store lane vectors as HELIX2_NEON_BLOCKS blocks in block layout
+static inline void _neon_store_blocks(const uint32x4_t *x, uint32_t *out) {
+    for (int i = 0; i < 16; i += 4) {
+        uint32x4_t r[4] = { x[i + 0], x[i + 1], x[i + 2], x[i + 3] };
+        _neon_transpose(r);
+        for (int j = 0; j < 4; j++) vst1q_u32(&out[j * 16 + i], r[j]);
+    }
+}
+
+// Build HELIX2_NEON_BLOCKS keystream blocks per iteration, lane j holds block_index + j
+void _helix2_keystream_neon(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks) {
+    uint32x4_t s[16], r[16], x[16];
+    uint32_t low[HELIX2_NEON_BLOCKS], high[HELIX2_NEON_BLOCKS];
+
+    for (int i = 0; i < 16; i++) {
+        s[i] = vdupq_n_u32(state[i]);
+        r[i] = vdupq_n_u32(rows[i]);
+    }
+
+    for (size_t n = 0; n < blocks; n += HELIX2_NEON_BLOCKS, block_index += HELIX2_NEON_BLOCKS) {
+        _HELIX2_COUNTERS(low, high, nonce_word, block_index, HELIX2_NEON_BLOCKS);
+        s[10] = vld1q_u32(low);
+        s[11] = vld1q_u32(high);
+
+        // Start from the cached rows, only the counter row is shuffled per block
+        for (int i = 0; i < 16; i++) x[i] = r[i];
+        x[8] = s[8]; x[9] = s[9]; x[10] = s[10]; x[11] = s[11];
+        _HELIX2_ROUNDS_FROM_ROWS(uint32x4_t, x, s, _NEON_ADD, _NEON_XOR, _NEON_ROTL);
+
+        _neon_store_blocks(x, &out[n * 16]);
+    }
+}
+
+// Build HELIX2_NEON_BLOCKS keystream blocks from independent block states, lane j runs states[j * 16 ..]
+void _helix2_lanes_neon(const uint32_t *states, uint32_t *out) {
+    uint32x4_t s[16], x[16];
+
+    for (int i = 0; i < 16; i += 4) {
+        uint32x4_t r[4];
+        for (int j = 0; j < 4; j++) r[j] = vld1q_u32(&states[j * 16 + i]);
+        _neon_transpose(r);
+        for (int j = 0; j < 4; j++) s[i + j] = r[j];
+    }
+
+    for (int i = 0; i < 16; i++) x[i] = s[i];
+    _HELIX2_ROUNDS(uint32x4_t, x, s, _NEON_ADD, _NEON_XOR, _NEON_ROTL);
+
+    _neon_store_blocks(x, out);
+}
+
+#endif
@@ -0,0 +1,495 @@
+/**
+ * @file helix2_opencl.c
+ * @brief Helix2 Stream Cipher, optional OpenCL keystream device for the asynchronous queue
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _HELIX2_EXPORT
+#define _HELIX2_THREADS
+#include "helix2_internal.h"
+
+#if defined(HELIX2_OPENCL)
+    #include <stdlib.h>
+    #ifndef _WIN32
+        #include <dlfcn.h>
+    #endif
+#endif
+
+#if defined(HELIX2_OPENCL)
+// The OpenCL runtime is loaded when a device is created, so a GPU=opencl library needs neither the OpenCL headers
+// to build nor an OpenCL runtime to run. Only the types, constants and entry points used below are declared here.
+#if defined(_WIN32)
+    #define _HELIX2_CL_CALL __stdcall
+#else
+    #define _HELIX2_CL_CALL
+#endif
+
+typedef int32_t _cl_int;
+typedef uint32_t _cl_uint;
+typedef uint64_t _cl_ulong;
+typedef uint64_t _cl_bitfield;
+typedef struct _cl_platform_id *_cl_platform_id;
+typedef struct _cl_device_id *_cl_device_id;
+typedef struct _cl_context *_cl_context;
+typedef struct _cl_command_queue *_cl_command_queue;
+typedef struct _cl_program *_cl_program;
+typedef struct _cl_kernel *_cl_kernel;
+typedef struct _cl_mem *_cl_mem;
+typedef struct _cl_event *_cl_event;
+
+#define _CL_SUCCESS              0
+#define _CL_FALSE                0
+#define _CL_DEVICE_TYPE_GPU      (1 << 2)
+#define _CL_DEVICE_TYPE_ALL      0xFFFFFFFF
+#define _CL_MEM_READ_WRITE       (1 << 0)
+#define _CL_MEM_READ_ONLY        (1 << 2)
+#define _CL_MEM_ALLOC_HOST_PTR   (1 << 4)
+#define _CL_MAP_READ             (1 << 0)
+#define _CL_MAP_WRITE            (1 << 1)
+#define _HELIX2_CL_PLATFORMS     16
+#define _HELIX2_CL_SLOTS         2          // jobs a device runs at the same time, each with its own buffers
+#define _HELIX2_CL_NONE          SIZE_MAX   // no chunk
+
+typedef struct
+{
+    _cl_int (_HELIX2_CL_CALL *GetPlatformIDs)(_cl_uint entries, _cl_platform_id *platforms, _cl_uint *count);
+    _cl_int (_HELIX2_CL_CALL *GetDeviceIDs)(_cl_platform_id platform, _cl_bitfield type, _cl_uint entries, _cl_device_id *devices, _cl_uint *count);
+    _cl_context (_HELIX2_CL_CALL *CreateContext)(const intptr_t *properties, _cl_uint count, const _cl_device_id *devices, void (_HELIX2_CL_CALL *notify)(const char *, const void *, size_t, void *), void *user, _cl_int *status);
+    _cl_command_queue (_HELIX2_CL_CALL *CreateCommandQueue)(_cl_context context, _cl_device_id device, _cl_bitfield properties, _cl_int *status);
+    _cl_program (_HELIX2_CL_CALL *CreateProgramWithSource)(_cl_context context, _cl_uint count, const char **sources, const size_t *lengths, _cl_int *status);
+    _cl_int (_HELIX2_CL_CALL *BuildProgram)(_cl_program program, _cl_uint count, const _cl_device_id *devices, const char *options, void (_HELIX2_CL_CALL *notify)(_cl_program, void *), void *user);
+    _cl_kernel (_HELIX2_CL_CALL *CreateKernel)(_cl_program program, const char *name, _cl_int *status);
+    _cl_mem (_HELIX2_CL_CALL *CreateBuffer)(_cl_context context, _cl_bitfield flags, size_t size, void *host, _cl_int *status);
+    _cl_int (_HELIX2_CL_CALL *SetKernelArg)(_cl_kernel kernel, _cl_uint index, size_t size, const void *value);
+    _cl_int (_HELIX2_CL_CALL *EnqueueWriteBuffer)(_cl_command_queue queue, _cl_mem buffer, _cl_uint blocking, size_t offset, size_t size, const void *data, _cl_uint waits, const _cl_event *wait, _cl_event *event);
+    _cl_int (_HELIX2_CL_CALL *EnqueueNDRangeKernel)(_cl_command_queue queue, _cl_kernel kernel, _cl_uint dims, const size_t *offset, const size_t *global, const size_t *local, _cl_uint waits, const _cl_event *wait, _cl_event *event);
+    void *(_HELIX2_CL_CALL *EnqueueMapBuffer)(_cl_command_queue queue, _cl_mem buffer, _cl_uint blocking, _cl_bitfield flags, size_t offset, size_t size, _cl_uint waits, const _cl_event *wait, _cl_event *event, _cl_int *status);
+    _cl_int (_HELIX2_CL_CALL *EnqueueUnmapMemObject)(_cl_command_queue queue, _cl_mem buffer, void *mapped, _cl_uint waits, const _cl_event *wait, _cl_event *event);
+    _cl_int (_HELIX2_CL_CALL *WaitForEvents)(_cl_uint count, const _cl_event *events);
+    _cl_int (_HELIX2_CL_CALL *ReleaseEvent)(_cl_event event);
+    _cl_int (_HELIX2_CL_CALL *Flush)(_cl_command_queue queue);
+    _cl_int (_HELIX2_CL_CALL *Finish)(_cl_command_queue queue);
+    _cl_int (_HELIX2_CL_CALL *ReleaseMemObject)(_cl_mem buffer);
+    _cl_int (_HELIX2_CL_CALL *ReleaseKernel)(_cl_kernel kernel);
+    _cl_int (_HELIX2_CL_CALL *ReleaseProgram)(_cl_program program);
+    _cl_int (_HELIX2_CL_CALL *ReleaseCommandQueue)(_cl_command_queue queue);
+    _cl_int (_HELIX2_CL_CALL *ReleaseContext)(_cl_context context);
+} _helix2_cl_api_t;
+
+// Buffers of one running job, chunk i of the job goes through data[i & 1]
+typedef struct
+{
+    _cl_mem key;                    // state and rows of the job's key schedule, 32 words
+    _cl_mem data[2];                // pinned host buffers (CL_MEM_ALLOC_HOST_PTR), chunk bytes each
+    bool busy;
+} _helix2_cl_slot_t;
+
+// One OpenCL device with its kernel and an in-order queue that the running jobs share
+struct helix2_opencl
+{
+    _helix2_cl_api_t cl;
+    void *library;
+    _cl_context context;
+    _cl_command_queue queue;
+    _cl_program program;
+    _cl_kernel kernel;
+    _helix2_cl_slot_t slots[_HELIX2_CL_SLOTS];
+    size_t chunk;                   // bytes per kernel launch
+    _helix2_lock_t lock;            // the slots, and the kernel arguments until the launch using them is enqueued
+    _helix2_cond_t slot_free;
+};
+
+// A job in flight: while the kernel runs on one pinned buffer the host empties and refills the other
+//   mapped[b] is the host pointer of buffer b while it is mapped, ready[b] the event of that map until waited for.
+typedef struct
+{
+    helix2_opencl_t *device;
+    _helix2_cl_slot_t *slot;
+    uint8_t *dst;
+    const uint8_t *src;             // NULL for raw keystream
+    size_t size;
+    uint64_t start_offset;
+    size_t chunks;
+    size_t done;                    // bytes in dst, always whole chunks from the start
+    uint8_t *mapped[2];
+    _cl_event ready[2];
+} _helix2_cl_job_t;
+
+// Word operations of the OpenCL C kernel, for the shared round macros of helix2_rounds.h
+#define _HELIX2_CL_ADD(a, b)    ((a) + (b))
+#define _HELIX2_CL_XOR(a, b)    ((a) ^ (b))
+#define _HELIX2_CL_ROTL(x, n)   rotate((x), (uint)(n))
+#define _HELIX2_CL_STRING(...)  _HELIX2_CL_STRING_(__VA_ARGS__)
+#define _HELIX2_CL_STRING_(...) #__VA_ARGS__
+
+// Keystream kernel, one work item per block: data[p] = keystream[p] (mode 0) or data[p] ^= keystream[p] (mode 1)
+//   for the bytes p in [0, size) of the blocks from first_block on, the first skip keystream bytes are not used.
+//   The rounds are the expansion of _HELIX2_ROUNDS_FROM_ROWS, so the kernel cannot drift from the CPU engines.
+//   Bytes are written in little-endian word order, like the keystream of the x86 and ARM builds.
+static const char *_helix2_cl_source =
+    "__kernel void helix2_keystream(__constant uint *key, ulong first_block, uint skip, ulong size, uint mode, __global uchar *data)\n"
+    "{\n"
+    "    uint s[16], x[16];\n"
+    "    size_t item = get_global_id(0);\n"
+    "    ulong block = first_block + item;\n"
+    "    for (int i = 0; i < 16; i++) {\n"
+    "        s[i] = key[i];\n"
+    "        x[i] = key[16 + i];\n"
+    "    }\n"
+    "    s[10] = (uint)block;\n"
+    "    s[11] = key[11] ^ (uint)(block >> 32);\n"
+    "    for (int i = 8; i < 12; i++) x[i] = s[i];\n"
+    "\n"
+    "    " _HELIX2_CL_STRING(_HELIX2_ROUNDS_FROM_ROWS(uint, x, s, _HELIX2_CL_ADD, _HELIX2_CL_XOR, _HELIX2_CL_ROTL)) ";\n"
+    "\n"
+    "    long base = (long)(item * 64) - (long)skip;\n"
+    "    for (int i = 0; i < 64; i++) {\n"
+    "        long p = base + i;\n"
+    "        if (p < 0 || p >= (long)size) continue;\n"
+    "        uchar k = (uchar)(x[i >> 2] >> (8 * (i & 3)));\n"
+    "        data[p] = mode != 0 ? (uchar)(data[p] ^ k) : k;\n"
+    "    }\n"
+    "}\n";
+
+// Internal helper function declarations
+static void *_helix2_opencl_library(void);
+static bool _helix2_opencl_load(_helix2_cl_api_t *cl, void *library);
+static _cl_device_id _helix2_opencl_pick(const _helix2_cl_api_t *cl);
+static bool _helix2_opencl_init(helix2_opencl_t *device, _cl_device_id id);
+static bool _helix2_opencl_map(_helix2_cl_job_t *job, size_t b, _cl_bitfield flags, const _cl_event *after);
+static bool _helix2_opencl_launch(_helix2_cl_job_t *job, size_t i);
+static bool _helix2_opencl_turn(_helix2_cl_job_t *job, size_t b, size_t out, size_t in);
+static void _helix2_opencl_drain(_helix2_cl_job_t *job);
+static bool _helix2_opencl_device_process(void *device, const helix2_key_t *schedule, uint8_t *dst, const uint8_t *src, size_t size, uint64_t start_offset);
+#endif
+
+// Exposed functions
+// Open the first OpenCL GPU (or any OpenCL device if there is no GPU) and build the keystream kernel for it
+//   chunk is the size of each pinned buffer and the most bytes per kernel launch (0 = HELIX2_OPENCL_CHUNK),
+//   the device runs two jobs at the same time with two pinned buffers each.
+//   Returns NULL without an OpenCL runtime or device, if the kernel does not build, or in a library built without
+//   GPU=opencl, so callers can always fall back to the CPU.
+HELIX2_API helix2_opencl_t* helix2_opencl_create(size_t chunk) {
+#if defined(HELIX2_OPENCL)
+    if (chunk == 0) chunk = HELIX2_OPENCL_CHUNK;
+
+    helix2_opencl_t *device = (helix2_opencl_t *)calloc(1, sizeof(helix2_opencl_t));
+    if (device == NULL) return NULL;
+    device->chunk = chunk;
+    _helix2_lock_init(&device->lock);
+    _helix2_cond_init(&device->slot_free);
+
+    device->library = _helix2_opencl_library();
+    _cl_device_id id = NULL;
+    if (device->library == NULL || !_helix2_opencl_load(&device->cl, device->library) ||
+        (id = _helix2_opencl_pick(&device->cl)) == NULL || !_helix2_opencl_init(device, id)) {
+        helix2_opencl_destroy(device);
+        return NULL;
+    }
+    return device;
+#else
+    (void)chunk;
+    return NULL;
+#endif
+}
+
+// dst = src ^ keystream, or raw keystream if src is NULL, for [start_offset, start_offset + size) run on the device
+//   dst may equal src. Thread-safe, calls on one device share its queue, more than _HELIX2_CL_SLOTS wait for a slot.
+//   Returns false, with dst untouched, when the device failed before any output (or device is NULL). A failure
+//   after that finishes the job on the CPU, so dst is never left half processed.
+HELIX2_API bool helix2_opencl_process(helix2_opencl_t* device, const helix2_key_t* schedule, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset) {
+#if defined(HELIX2_OPENCL)
+    if (device == NULL) return false;
+    if (size == 0) return true;
+
+    uint32_t words[2 * HELIX2_KEYSTREAM_SIZE / sizeof(uint32_t)];
+    memcpy(&words[0], schedule->state, HELIX2_KEYSTREAM_SIZE);
+    memcpy(&words[16], schedule->rows, HELIX2_KEYSTREAM_SIZE);
+
+    _helix2_cl_job_t job = { device, NULL, dst, src, size, start_offset, (size + device->chunk - 1) / device->chunk, 0, { NULL, NULL }, { NULL, NULL } };
+    _helix2_lock_acquire(&device->lock);
+    while (job.slot == NULL) {
+        for (size_t i = 0; i < _HELIX2_CL_SLOTS && job.slot == NULL; i++) {
+            if (!device->slots[i].busy) job.slot = &device->slots[i];
+        }
+        if (job.slot == NULL) _helix2_cond_wait(&device->slot_free, &device->lock);
+    }
+    job.slot->busy = true;
+    _helix2_lock_release(&device->lock);
+
+    // words outlives the non-blocking write, a job waits for the maps that follow its last kernel before it returns
+    bool ok = device->cl.EnqueueWriteBuffer(device->queue, job.slot->key, _CL_FALSE, 0, sizeof(words), words, 0, NULL, NULL) == _CL_SUCCESS;
+    if (ok && src != NULL) ok = _helix2_opencl_map(&job, 0, _CL_MAP_WRITE, NULL) && _helix2_opencl_turn(&job, 0, _HELIX2_CL_NONE, 0);
+
+    // While the kernel runs chunk i, the host copies chunk i - 1 out of the other buffer and chunk i + 1 into it
+    for (size_t i = 0; ok && i < job.chunks; i++) {
+        ok = _helix2_opencl_launch(&job, i);
+        size_t in = src != NULL && i + 1 < job.chunks ? i + 1 : _HELIX2_CL_NONE;
+        if (ok && (i > 0 || in != _HELIX2_CL_NONE)) ok = _helix2_opencl_turn(&job, (i + 1) & 1, i > 0 ? i - 1 : _HELIX2_CL_NONE, in);
+    }
+    if (ok) ok = _helix2_opencl_turn(&job, (job.chunks - 1) & 1, job.chunks - 1, _HELIX2_CL_NONE);
+    if (!ok) _helix2_opencl_drain(&job);
+
+    _helix2_lock_acquire(&device->lock);
+    job.slot->busy = false;
+    _helix2_cond_notify(&device->slot_free);
+    _helix2_lock_release(&device->lock);
+
+    size_t done = job.done;
+    if (done == 0) return false;
+    if (done < size) {
+        if (src == NULL) helix2_key_keystream(schedule, dst + done, size - done, start_offset + done);
+        else helix2_key_buffer_copy(schedule, dst + done, src + done, size - done, start_offset + done);
+    }
+    return true;
+#else
+    (void)device; (void)schedule; (void)dst; (void)src; (void)size; (void)start_offset;
+    return false;
+#endif
+}
+
+// Offload hook for helix2_async_create that sends every job to the device, all members NULL if device is NULL
+HELIX2_API helix2_offload_t helix2_opencl_offload(helix2_opencl_t* device) {
+    helix2_offload_t offload = { NULL, NULL };
+#if defined(HELIX2_OPENCL)
+    if (device != NULL) {
+        offload.process = _helix2_opencl_device_process;
+        offload.device = device;
+    }
+#else
+    (void)device;
+#endif
+    return offload;
+}
+
+// Release the kernel, the buffers and the OpenCL runtime, after every queue using the device is destroyed
+HELIX2_API void helix2_opencl_destroy(helix2_opencl_t* device) {
+#if defined(HELIX2_OPENCL)
+    if (device == NULL) return;
+
+    const _helix2_cl_api_t *cl = &device->cl;
+    for (size_t i = 0; i < _HELIX2_CL_SLOTS; i++) {
+        _helix2_cl_slot_t *slot = &device->slots[i];
+        if (slot->data[0] != NULL) cl->ReleaseMemObject(slot->data[0]);
+        if (slot->data[1] != NULL) cl->ReleaseMemObject(slot->data[1]);
+        if (slot->key != NULL) cl->ReleaseMemObject(slot->key);
+    }
+    if (device->kernel != NULL) cl->ReleaseKernel(device->kernel);
+    if (device->program != NULL) cl->ReleaseProgram(device->program);
+    if (device->queue != NULL) cl->ReleaseCommandQueue(device->queue);
+    if (device->context != NULL) cl->ReleaseContext(device->context);
+#ifdef _WIN32
+    if (device->library != NULL) FreeLibrary((HMODULE)device->library);
+#else
+    if (device->library != NULL) dlclose(device->library);
+#endif
+
+    _helix2_cond_destroy(&device->slot_free);
+    _helix2_lock_destroy(&device->lock);
+    free(device);
+#else
+    (void)device;
+#endif
+}
+
+#if defined(HELIX2_OPENCL)
+// Internal helper functions
+// The OpenCL ICD loader, NULL if none is installed
+static void *_helix2_opencl_library(void) {
+#ifdef _WIN32
+    return (void *)LoadLibraryA("OpenCL.dll");
+#else
+    void *library = dlopen("libOpenCL.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (library == NULL) library = dlopen("libOpenCL.so", RTLD_NOW | RTLD_LOCAL);
+    return library;
+#endif
+}
+
+// Look up every entry point, false if the runtime lacks one
+static bool _helix2_opencl_load(_helix2_cl_api_t *cl, void *library) {
+#ifdef _WIN32
+    #define _HELIX2_CL_LOAD(name) ((*(void **)&cl->name = (void *)GetProcAddress((HMODULE)library, "cl" #name)) != NULL)
+#else
+    #define _HELIX2_CL_LOAD(name) ((*(void **)&cl->name = dlsym(library, "cl" #name)) != NULL)
+#endif
+    return _HELIX2_CL_LOAD(GetPlatformIDs) && _HELIX2_CL_LOAD(GetDeviceIDs) && _HELIX2_CL_LOAD(CreateContext) &&
+           _HELIX2_CL_LOAD(CreateCommandQueue) && _HELIX2_CL_LOAD(CreateProgramWithSource) && _HELIX2_CL_LOAD(BuildProgram) &&
+           _HELIX2_CL_LOAD(CreateKernel) && _HELIX2_CL_LOAD(CreateBuffer) && _HELIX2_CL_LOAD(SetKernelArg) &&
+           _HELIX2_CL_LOAD(EnqueueWriteBuffer) && _HELIX2_CL_LOAD(EnqueueNDRangeKernel) && _HELIX2_CL_LOAD(EnqueueMapBuffer) &&
+           _HELIX2_CL_LOAD(EnqueueUnmapMemObject) && _HELIX2_CL_LOAD(WaitForEvents) && _HELIX2_CL_LOAD(ReleaseEvent) &&
+           _HELIX2_CL_LOAD(Flush) && _HELIX2_CL_LOAD(Finish) && _HELIX2_CL_LOAD(ReleaseMemObject) && _HELIX2_CL_LOAD(ReleaseKernel) &&
+           _HELIX2_CL_LOAD(ReleaseProgram) && _HELIX2_CL_LOAD(ReleaseCommandQueue) && _HELIX2_CL_LOAD(ReleaseContext);
+    #undef _HELIX2_CL_LOAD
+}
+
+// First GPU of any platform, otherwise the first device of any type (ex. a CPU runtime such as PoCL)
+static _cl_device_id _helix2_opencl_pick(const _helix2_cl_api_t *cl) {
+    _cl_platform_id platforms[_HELIX2_CL_PLATFORMS];
+    _cl_uint count = 0;
+    if (cl->GetPlatformIDs(_HELIX2_CL_PLATFORMS, platforms, &count) != _CL_SUCCESS) return NULL;
+    if (count > _HELIX2_CL_PLATFORMS) count = _HELIX2_CL_PLATFORMS;
+
+    const _cl_bitfield types[] = { _CL_DEVICE_TYPE_GPU, _CL_DEVICE_TYPE_ALL };
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        for (_cl_uint p = 0; p < count; p++) {
+            _cl_device_id id = NULL;
+            if (cl->GetDeviceIDs(platforms[p], types[t], 1, &id, NULL) == _CL_SUCCESS && id != NULL) return id;
+        }
+    }
+    return NULL;
+}
+
+// Context, in-order queue, kernel and buffers of a device, the partly built ones are released by helix2_opencl_destroy
+static bool _helix2_opencl_init(helix2_opencl_t *device, _cl_device_id id) {
+    const _helix2_cl_api_t *cl = &device->cl;
+    _cl_int status;
+
+    device->context = cl->CreateContext(NULL, 1, &id, NULL, NULL, &status);
+    if (status != _CL_SUCCESS) return false;
+    device->queue = cl->CreateCommandQueue(device->context, id, 0, &status);
+    if (status != _CL_SUCCESS) return false;
+
+    device->program = cl->CreateProgramWithSource(device->context, 1, &_helix2_cl_source, NULL, &status);
+    if (status != _CL_SUCCESS) return false;
+    if (cl->BuildProgram(device->program, 1, &id, NULL, NULL, NULL) != _CL_SUCCESS) return false;
+    device->kernel = cl->CreateKernel(device->program, "helix2_keystream", &status);
+    if (status != _CL_SUCCESS) return false;
+
+    for (size_t i = 0; i < _HELIX2_CL_SLOTS; i++) {
+        _helix2_cl_slot_t *slot = &device->slots[i];
+        slot->key = cl->CreateBuffer(device->context, _CL_MEM_READ_ONLY, 2 * HELIX2_KEYSTREAM_SIZE, NULL, &status);
+        if (status != _CL_SUCCESS) return false;
+        for (size_t b = 0; b < 2; b++) {
+            slot->data[b] = cl->CreateBuffer(device->context, _CL_MEM_READ_WRITE | _CL_MEM_ALLOC_HOST_PTR, device->chunk, NULL, &status);
+            if (status != _CL_SUCCESS) return false;
+        }
+    }
+    return true;
+}
+
+// Enqueue a non-blocking map of buffer b that waits for *after (after NULL for none), the next turn on b waits for it
+static bool _helix2_opencl_map(_helix2_cl_job_t *job, size_t b, _cl_bitfield flags, const _cl_event *after) {
+    const _helix2_cl_api_t *cl = &job->device->cl;
+    _cl_int status;
+    job->mapped[b] = (uint8_t *)cl->EnqueueMapBuffer(job->device->queue, job->slot->data[b], _CL_FALSE, flags, 0, job->device->chunk,
+                                                     after != NULL, after, &job->ready[b], &status);
+    if (status == _CL_SUCCESS) return true;
+    job->mapped[b] = NULL;
+    job->ready[b] = NULL;
+    return false;
+}
+
+// Enqueue chunk i on buffer i & 1: the unmap of its input, the kernel after it, and a map for the host after the kernel
+//   That map also writes when the host refills the buffer with chunk i + 2. Chunk 0 first maps buffer 1 for the
+//   input of chunk 1, so the host copies it while kernel 0 runs.
+static bool _helix2_opencl_launch(_helix2_cl_job_t *job, size_t i) {
+    helix2_opencl_t *device = job->device;
+    const _helix2_cl_api_t *cl = &device->cl;
+    size_t b = i & 1;
+    size_t offset = i * device->chunk;
+    size_t size = job->size - offset < device->chunk ? job->size - offset : device->chunk;
+    uint64_t start_offset = job->start_offset + offset;
+
+    if (i == 0 && job->src != NULL && job->chunks > 1 && !_helix2_opencl_map(job, 1, _CL_MAP_WRITE, NULL)) return false;
+
+    _cl_event unmapped = NULL, ran = NULL;
+    if (job->mapped[b] != NULL) {
+        if (cl->EnqueueUnmapMemObject(device->queue, job->slot->data[b], job->mapped[b], 0, NULL, &unmapped) != _CL_SUCCESS) return false;
+        job->mapped[b] = NULL;
+    }
+
+    _cl_ulong first_block = start_offset / HELIX2_KEYSTREAM_SIZE;
+    _cl_uint skip = (_cl_uint)(start_offset % HELIX2_KEYSTREAM_SIZE);
+    _cl_ulong bytes = size;
+    _cl_uint mode = job->src != NULL;
+    size_t blocks = (skip + size + HELIX2_KEYSTREAM_SIZE - 1) / HELIX2_KEYSTREAM_SIZE;
+
+    // The launch takes the argument values when it is enqueued, the next job may set its own right after
+    _helix2_lock_acquire(&device->lock);
+    bool ok = cl->SetKernelArg(device->kernel, 0, sizeof(_cl_mem), &job->slot->key) == _CL_SUCCESS &&
+              cl->SetKernelArg(device->kernel, 1, sizeof(first_block), &first_block) == _CL_SUCCESS &&
+              cl->SetKernelArg(device->kernel, 2, sizeof(skip), &skip) == _CL_SUCCESS &&
+              cl->SetKernelArg(device->kernel, 3, sizeof(bytes), &bytes) == _CL_SUCCESS &&
+              cl->SetKernelArg(device->kernel, 4, sizeof(mode), &mode) == _CL_SUCCESS &&
+              cl->SetKernelArg(device->kernel, 5, sizeof(_cl_mem), &job->slot->data[b]) == _CL_SUCCESS &&
+              cl->EnqueueNDRangeKernel(device->queue, device->kernel, 1, NULL, &blocks, NULL, unmapped != NULL, unmapped != NULL ? &unmapped : NULL, &ran) == _CL_SUCCESS;
+    _helix2_lock_release(&device->lock);
+    if (unmapped != NULL) cl->ReleaseEvent(unmapped);
+
+    _cl_bitfield flags = _CL_MAP_READ | (job->src != NULL && i + 2 < job->chunks ? _CL_MAP_WRITE : 0);
+    ok = ok && _helix2_opencl_map(job, b, flags, &ran);
+    if (ran != NULL) cl->ReleaseEvent(ran);
+    return ok && cl->Flush(device->queue) == _CL_SUCCESS;
+}
+
+// Host side of buffer b: wait for its map, copy chunk out to dst and chunk in from src (_HELIX2_CL_NONE for neither)
+//   A refilled buffer stays mapped until the launch of its chunk unmaps it, any other is unmapped here.
+static bool _helix2_opencl_turn(_helix2_cl_job_t *job, size_t b, size_t out, size_t in) {
+    const _helix2_cl_api_t *cl = &job->device->cl;
+    size_t chunk = job->device->chunk;
+    _cl_int status = cl->WaitForEvents(1, &job->ready[b]);
+    cl->ReleaseEvent(job->ready[b]);
+    job->ready[b] = NULL;
+    if (status != _CL_SUCCESS) return false;
+
+    if (out != _HELIX2_CL_NONE) {
+        size_t size = job->size - out * chunk < chunk ? job->size - out * chunk : chunk;
+        memcpy(job->dst + out * chunk, job->mapped[b], size);
+        job->done += size;
+    }
+    if (in != _HELIX2_CL_NONE) {
+        size_t size = job->size - in * chunk < chunk ? job->size - in * chunk : chunk;
+        memcpy(job->mapped[b], job->src + in * chunk, size);
+        return true;
+    }
+
+    if (cl->EnqueueUnmapMemObject(job->device->queue, job->slot->data[b], job->mapped[b], 0, NULL, NULL) != _CL_SUCCESS) return false;
+    job->mapped[b] = NULL;
+    return true;
+}
+
+// After a failure, wait for the commands on the queue (other jobs' too) and hand the buffers back unmapped
+static void _helix2_opencl_drain(_helix2_cl_job_t *job) {
+    const _helix2_cl_api_t *cl = &job->device->cl;
+    cl->Finish(job->device->queue);
+    for (size_t b = 0; b < 2; b++) {
+        if (job->ready[b] != NULL) cl->ReleaseEvent(job->ready[b]);
+        if (job->mapped[b] != NULL) cl->EnqueueUnmapMemObject(job->device->queue, job->slot->data[b], job->mapped[b], 0, NULL, NULL);
+    }
+    cl->Finish(job->device->queue);
+}
+
+// helix2_offload_t process function of a device
+static bool _helix2_opencl_device_process(void *device, const helix2_key_t *schedule, uint8_t *dst, const uint8_t *src, size_t size, uint64_t start_offset) {
+    return helix2_opencl_process((helix2_opencl_t *)device, schedule, dst, src, size, start_offset);
+}
+#endif
@@ -0,0 +1,200 @@
+/**
+ * @file helix2_parallel.c
+ * @brief Helix2 Stream Cipher, multi-threaded buffer processing
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+    #define _DEFAULT_SOURCE     // sysconf(_SC_NPROCESSORS_ONLN)
+#endif
+
+#define _HELIX2_EXPORT
+#include "helix2_internal.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+// One parallel job, the buffer split into chunks that start on keystream block boundaries
+//   Chunk 0 is [0, lead + chunk), chunk i is [lead + i * chunk, lead + (i + 1) * chunk), the last one clipped to size.
+typedef struct
+{
+    const helix2_key_t *schedule;
+    uint8_t *buffer;
+    size_t size;
+    uint64_t start_offset;
+    size_t lead;                    // bytes up to the first block boundary
+    size_t chunk;                   // multiple of HELIX2_PARALLEL_GRAIN
+    size_t count;
+} _helix2_parallel_job_t;
+
+typedef struct
+{
+    _helix2_parallel_job_t *job;
+    size_t index;
+} _helix2_parallel_worker_t;
+
+// Internal helper function declarations
+static void _helix2_parallel_task(void *task_arg, size_t index);
+static void _helix2_parallel_threads(_helix2_parallel_job_t *job);
+static unsigned int _helix2_cpu_count(void);
+
+// Exposed functions
+// Encrypt/Decrypt a buffer on several threads, same result as helix2_key_buffer
+//   parallel may be NULL, which uses one thread per online CPU.
+HELIX2_API void helix2_key_buffer_parallel(const helix2_key_t* schedule, uint8_t* buffer, size_t size, uint64_t start_offset, const helix2_parallel_t* parallel) {
+    _helix2_parallel_job_t job;
+    job.schedule = schedule;
+    job.buffer = buffer;
+    job.size = size;
+    job.start_offset = start_offset;
+    job.lead = (HELIX2_KEYSTREAM_SIZE - (size_t)(start_offset % HELIX2_KEYSTREAM_SIZE)) % HELIX2_KEYSTREAM_SIZE;
+
+    if (parallel != NULL && parallel->parallel_for != NULL) {
+        // Caller supplied pool, fixed size chunks and let the pool balance them
+        job.chunk = HELIX2_PARALLEL_POOL_CHUNK;
+    } else {
+        unsigned int threads = (parallel != NULL && parallel->threads != 0) ? parallel->threads : _helix2_cpu_count();
+        if (threads > HELIX2_PARALLEL_MAX_THREADS) threads = HELIX2_PARALLEL_MAX_THREADS;
+        if (threads <= 1 || size < 2 * HELIX2_PARALLEL_MIN_CHUNK) {
+            helix2_key_buffer(schedule, buffer, size, start_offset);
+            return;
+        }
+
+        // One chunk per thread, rounded up to whole engine batches
+        job.chunk = (size + threads - 1) / threads;
+        job.chunk = (job.chunk + HELIX2_PARALLEL_GRAIN - 1) / HELIX2_PARALLEL_GRAIN * HELIX2_PARALLEL_GRAIN;
+        if (job.chunk < HELIX2_PARALLEL_MIN_CHUNK) job.chunk = HELIX2_PARALLEL_MIN_CHUNK;
+    }
+
+    job.count = (size <= job.lead) ? 1 : (size - job.lead + job.chunk - 1) / job.chunk;
+
+    if (job.count == 1) {
+        helix2_key_buffer(schedule, buffer, size, start_offset);
+    } else if (parallel != NULL && parallel->parallel_for != NULL) {
+        parallel->parallel_for(parallel->pool, _helix2_parallel_task, &job, job.count);
+    } else {
+        _helix2_parallel_threads(&job);
+    }
+}
+
+// Encrypt/Decrypt a buffer on several threads, same result and context state as helix2_buffer
+HELIX2_API void helix2_buffer_parallel(helix2_context_t* context, uint8_t* buffer, size_t size, uint64_t start_offset, const helix2_parallel_t* parallel) {
+    helix2_key_t schedule;
+    _helix2_context_key(context, &schedule);
+
+    helix2_key_buffer_parallel(&schedule, buffer, size, start_offset, parallel);
+
+    // Leave the last block in the context, like helix2_buffer
+    uint64_t last_block = (size == 0 ? start_offset : start_offset + size - 1) / HELIX2_KEYSTREAM_SIZE;
+    _helix2_initialize_keystream(context, last_block);
+}
+
+
+// Internal helper functions
+// Process chunk `index` of a job
+static void _helix2_parallel_task(void *task_arg, size_t index) {
+    _helix2_parallel_job_t *job = (_helix2_parallel_job_t *)task_arg;
+
+    size_t begin = (index == 0) ? 0 : job->lead + index * job->chunk;
+    size_t end = job->lead + (index + 1) * job->chunk;
+    if (end > job->size) end = job->size;
+
+    helix2_key_buffer(job->schedule, job->buffer + begin, end - begin, job->start_offset + begin);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI _helix2_parallel_thread(LPVOID arg) {
+    _helix2_parallel_worker_t *worker = (_helix2_parallel_worker_t *)arg;
+    _helix2_parallel_task(worker->job, worker->index);
+    return 0;
+}
+#else
+static void *_helix2_parallel_thread(void *arg) {
+    _helix2_parallel_worker_t *worker = (_helix2_parallel_worker_t *)arg;
+    _helix2_parallel_task(worker->job, worker->index);
+    return NULL;
+}
+#endif
+
+// Built-in threads, one per chunk, chunk 0 runs on the calling thread
+//   A chunk whose thread cannot be started is processed by the calling thread instead.
+static void _helix2_parallel_threads(_helix2_parallel_job_t *job) {
+    _helix2_parallel_worker_t workers[HELIX2_PARALLEL_MAX_THREADS];
+    bool started[HELIX2_PARALLEL_MAX_THREADS] = {false};
+#ifdef _WIN32
+    HANDLE threads[HELIX2_PARALLEL_MAX_THREADS];
+#else
+    pthread_t threads[HELIX2_PARALLEL_MAX_THREADS];
+#endif
+
+    for (size_t i = 1; i < job->count; i++) {
+        workers[i].job = job;
+        workers[i].index = i;
+#ifdef _WIN32
+        threads[i] = CreateThread(NULL, 0, _helix2_parallel_thread, &workers[i], 0, NULL);
+        started[i] = threads[i] != NULL;
+#else
+        started[i] = pthread_create(&threads[i], NULL, _helix2_parallel_thread, &workers[i]) == 0;
+#endif
+    }
+
+    _helix2_parallel_task(job, 0);
+
+    for (size_t i = 1; i < job->count; i++) {
+        if (!started[i]) {
+            _helix2_parallel_task(job, i);
+            continue;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+    }
+}
+
+// Number of online CPUs
+static unsigned int _helix2_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+#endif
+}
@@ -0,0 +1,143 @@
+/**
+ * @file helix2_pool.c
+ * @brief Helix2 Stream Cipher, cache line aligned object pools
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _HELIX2_EXPORT
+#include "helix2_internal.h"
+#include <stdlib.h>
+
+// One allocation of the pool, its objects follow the header at the next cache line
+typedef struct _helix2_pool_chunk
+{
+    struct _helix2_pool_chunk *next;
+    void *allocation;               // what malloc returned, the chunk itself is aligned inside it
+} _helix2_pool_chunk_t;
+
+// Free objects form a list through their first bytes
+typedef struct _helix2_pool_free
+{
+    struct _helix2_pool_free *next;
+} _helix2_pool_free_t;
+
+struct helix2_pool
+{
+    size_t object_size;             // rounded up to whole cache lines
+    size_t chunk_objects;
+    _helix2_pool_chunk_t *chunks;
+    _helix2_pool_free_t *free;
+};
+
+#define _HELIX2_POOL_HEADER  ((sizeof(_helix2_pool_chunk_t) + HELIX2_CACHE_LINE - 1) / HELIX2_CACHE_LINE * HELIX2_CACHE_LINE)
+
+// Internal helper function declarations
+static bool _helix2_pool_grow(helix2_pool_t *pool);
+
+// Exposed functions
+// Create an empty pool for objects of object_size bytes, ex. helix2_pool_create(sizeof(helix2_session_t), 4096)
+//   Every object starts on a cache line and takes whole cache lines, so no two objects share one.
+//   Returns NULL if object_size or chunk_objects is 0, or out of memory.
+HELIX2_API helix2_pool_t* helix2_pool_create(size_t object_size, size_t chunk_objects) {
+    if (object_size == 0 || chunk_objects == 0) return NULL;
+    if (object_size > SIZE_MAX - HELIX2_CACHE_LINE) return NULL;
+
+    size_t size = (object_size + HELIX2_CACHE_LINE - 1) / HELIX2_CACHE_LINE * HELIX2_CACHE_LINE;
+    if (chunk_objects > (SIZE_MAX - _HELIX2_POOL_HEADER - HELIX2_CACHE_LINE) / size) return NULL;
+
+    helix2_pool_t *pool = (helix2_pool_t *)malloc(sizeof(helix2_pool_t));
+    if (pool == NULL) return NULL;
+
+    pool->object_size = size;
+    pool->chunk_objects = chunk_objects;
+    pool->chunks = NULL;
+    pool->free = NULL;
+    return pool;
+}
+
+// Take an object from the pool, its contents are zero, returns NULL when out of memory
+HELIX2_API void* helix2_pool_alloc(helix2_pool_t* pool) {
+    if (pool->free == NULL && !_helix2_pool_grow(pool)) return NULL;
+
+    _helix2_pool_free_t *object = pool->free;
+    pool->free = object->next;
+    object->next = NULL;
+    return object;
+}
+
+// Return an object to its pool, it is wiped first so no key material stays behind (NULL is ignored)
+HELIX2_API void helix2_pool_free(helix2_pool_t* pool, void* object) {
+    if (object == NULL) return;
+
+    memset(object, 0, pool->object_size);
+    _helix2_pool_free_t *entry = (_helix2_pool_free_t *)object;
+    entry->next = pool->free;
+    pool->free = entry;
+}
+
+// Release the pool and every object allocated from it, the objects are wiped
+HELIX2_API void helix2_pool_destroy(helix2_pool_t* pool) {
+    if (pool == NULL) return;
+
+    _helix2_pool_chunk_t *chunk = pool->chunks;
+    while (chunk != NULL) {
+        _helix2_pool_chunk_t *next = chunk->next;
+        void *allocation = chunk->allocation;
+        memset((uint8_t *)chunk + _HELIX2_POOL_HEADER, 0, pool->object_size * pool->chunk_objects);
+        free(allocation);
+        chunk = next;
+    }
+    free(pool);
+}
+
+
+// Internal helper functions
+// Add a chunk of zeroed objects to the free list, in address order so consecutive allocations are adjacent
+static bool _helix2_pool_grow(helix2_pool_t *pool) {
+    size_t objects = pool->object_size * pool->chunk_objects;
+    void *allocation = calloc(1, _HELIX2_POOL_HEADER + objects + HELIX2_CACHE_LINE - 1);
+    if (allocation == NULL) return false;
+
+    uintptr_t aligned = ((uintptr_t)allocation + HELIX2_CACHE_LINE - 1) & ~(uintptr_t)(HELIX2_CACHE_LINE - 1);
+    _helix2_pool_chunk_t *chunk = (_helix2_pool_chunk_t *)aligned;
+    chunk->allocation = allocation;
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+
+    uint8_t *first = (uint8_t *)chunk + _HELIX2_POOL_HEADER;
+    for (size_t i = pool->chunk_objects; i-- > 0; ) {
+        _helix2_pool_free_t *entry = (_helix2_pool_free_t *)(first + i * pool->object_size);
+        entry->next = pool->free;
+        pool->free = entry;
+    }
+    return true;
+}
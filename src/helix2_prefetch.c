@@ -0,0 +1,309 @@
+/**
+ * @file helix2_prefetch.c
+ * @brief Helix2 Stream Cipher, keystream prefetch ring
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L     // nanosleep
+#endif
+
+#define _HELIX2_EXPORT
+#include "helix2_internal.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <sched.h>
+    #include <time.h>
+#endif
+
+#define _HELIX2_PREFETCH_DEFAULT     (64 * 1024)     // ring size for capacity 0, stays in L2 next to the packets
+#define _HELIX2_PREFETCH_MIN_BLOCKS  (2 * HELIX2_MAX_BLOCKS)
+#define _HELIX2_PREFETCH_SPINS       64              // idle rounds the producer thread yields before it sleeps
+
+// Ring of keystream blocks, slot i holds block b with b % blocks == i
+//   The producer owns head, the consumer owns tail and offset, each on its own cache line.
+//   Blocks [valid, head) are in the ring, valid is the highest tail ever published: the producer only writes
+//   block b while b - tail < blocks and only ever skips forward to a tail it has seen (see helix2_prefetch_fill).
+struct helix2_prefetch
+{
+    helix2_key_t schedule;
+    uint32_t *ring;
+    size_t blocks;                  // power of two
+    void *allocation;
+
+    HELIX2_ALIGNED(HELIX2_CACHE_LINE) _Atomic uint64_t tail;      // block of the next byte the consumer reads
+    uint64_t offset;                // keystream offset of that byte
+    uint64_t valid;
+
+    HELIX2_ALIGNED(HELIX2_CACHE_LINE) _Atomic uint64_t head;      // one past the last block written
+
+    HELIX2_ALIGNED(HELIX2_CACHE_LINE) atomic_bool running;
+    bool started;
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+};
+
+// Internal helper function declarations
+static size_t _helix2_prefetch_blocks(size_t capacity);
+static void _helix2_prefetch_publish(helix2_prefetch_t *prefetch);
+static void _helix2_prefetch_idle(unsigned int *idle);
+static void _helix2_prefetch_run(helix2_prefetch_t *prefetch);
+#ifdef _WIN32
+static DWORD WINAPI _helix2_prefetch_thread(LPVOID arg);
+#else
+static void *_helix2_prefetch_thread(void *arg);
+#endif
+
+// Exposed functions
+// Create a prefetch ring for the keystream of key and nonce from start_offset on, capacity bytes (0 = 64 KB)
+//   The capacity is rounded up to a power of two number of blocks. Returns NULL when out of memory.
+HELIX2_API helix2_prefetch_t* helix2_prefetch_create(const uint8_t* key, const uint8_t* nonce, uint64_t start_offset, size_t capacity) {
+    size_t blocks = _helix2_prefetch_blocks(capacity);
+    if (blocks == 0) return NULL;
+
+    // One allocation, the struct and the ring both start on a cache line
+    size_t header = (sizeof(helix2_prefetch_t) + HELIX2_CACHE_LINE - 1) / HELIX2_CACHE_LINE * HELIX2_CACHE_LINE;
+    void *allocation = calloc(1, header + blocks * HELIX2_KEYSTREAM_SIZE + HELIX2_CACHE_LINE - 1);
+    if (allocation == NULL) return NULL;
+
+    uintptr_t aligned = ((uintptr_t)allocation + HELIX2_CACHE_LINE - 1) & ~(uintptr_t)(HELIX2_CACHE_LINE - 1);
+    helix2_prefetch_t *prefetch = (helix2_prefetch_t *)aligned;
+    prefetch->allocation = allocation;
+    prefetch->ring = (uint32_t *)(aligned + header);
+    prefetch->blocks = blocks;
+
+    helix2_initialize_key(&prefetch->schedule, key, nonce);
+    prefetch->offset = start_offset;
+    prefetch->valid = start_offset / HELIX2_KEYSTREAM_SIZE;
+    atomic_init(&prefetch->tail, prefetch->valid);
+    atomic_init(&prefetch->head, prefetch->valid);
+    atomic_init(&prefetch->running, false);
+    prefetch->started = false;
+    return prefetch;
+}
+
+// Producer: generate up to max_bytes (rounded up to blocks, 0 = until the ring is full) of upcoming keystream
+//   Call it from one thread at a time (a background thread, or idle time of the consumer thread),
+//   concurrently with helix2_prefetch_update. Returns the number of keystream bytes added.
+HELIX2_API size_t helix2_prefetch_fill(helix2_prefetch_t* prefetch, size_t max_bytes) {
+    uint64_t tail = atomic_load_explicit(&prefetch->tail, memory_order_acquire);
+    uint64_t head = atomic_load_explicit(&prefetch->head, memory_order_relaxed);
+    size_t limit = max_bytes == 0 ? SIZE_MAX : max_bytes / HELIX2_KEYSTREAM_SIZE + (max_bytes % HELIX2_KEYSTREAM_SIZE != 0);
+    size_t produced = 0;
+
+    // The consumer ran past the ring (inline fallback or seek), continue from where it is now
+    if (head < tail) head = tail;
+
+    while (produced < limit && head - tail < prefetch->blocks) {
+        size_t slot = (size_t)(head & (prefetch->blocks - 1));
+        size_t run = prefetch->blocks - (size_t)(head - tail);
+        if (run > prefetch->blocks - slot) run = prefetch->blocks - slot;
+        if (run > limit - produced) run = limit - produced;
+        if (run > HELIX2_MAX_BLOCKS) run = HELIX2_MAX_BLOCKS;
+
+        const _helix2_engine_t *engine = _helix2_get_engine_for(run);
+        run -= run % engine->blocks;
+        engine->keystream(prefetch->schedule.state, prefetch->schedule.rows, prefetch->schedule.state[11], head, &prefetch->ring[slot * 16], run);
+        _HELIX2_STATS_BLOCKS(engine->backend, run);
+
+        head += run;
+        produced += run;
+        atomic_store_explicit(&prefetch->head, head, memory_order_release);
+    }
+    return produced * HELIX2_KEYSTREAM_SIZE;
+}
+
+// Consumer: encrypt/decrypt the next size bytes of the stream
+//   Prefetched keystream is only XORed in, whatever the ring does not hold yet is generated inline.
+HELIX2_API void helix2_prefetch_update(helix2_prefetch_t* prefetch, uint8_t* buffer, size_t size) {
+    uint64_t head = atomic_load_explicit(&prefetch->head, memory_order_acquire);
+    uint64_t offset = prefetch->offset;
+
+    while (size > 0) {
+        uint64_t block = offset / HELIX2_KEYSTREAM_SIZE;
+        size_t block_offset = (size_t)(offset % HELIX2_KEYSTREAM_SIZE);
+        if (block >= head) head = atomic_load_explicit(&prefetch->head, memory_order_acquire);
+        if (block < prefetch->valid || block >= head) break;
+
+        // Contiguous ready blocks up to the end of the ring
+        size_t slot = (size_t)(block & (prefetch->blocks - 1));
+        size_t ready = prefetch->blocks - slot;
+        if (head - block < ready) ready = (size_t)(head - block);
+
+        size_t chunk = ready * HELIX2_KEYSTREAM_SIZE - block_offset;
+        if (chunk > size) chunk = size;
+
+        _helix2_xor(buffer, buffer, (const uint8_t *)&prefetch->ring[slot * 16] + block_offset, chunk);
+        _HELIX2_STATS_BYTES(chunk);
+        buffer += chunk;
+        size -= chunk;
+        offset += chunk;
+    }
+
+    // Ring empty (or behind), fall back to inline generation for the rest
+    if (size > 0) {
+        helix2_key_buffer(&prefetch->schedule, buffer, size, offset);
+        offset += size;
+    }
+
+    prefetch->offset = offset;
+    _helix2_prefetch_publish(prefetch);
+}
+
+// Consumer: move the stream to a keystream offset
+//   Forward seeks drop the blocks skipped over, after a backward seek the blocks before the old position are generated inline.
+HELIX2_API void helix2_prefetch_seek(helix2_prefetch_t* prefetch, uint64_t offset) {
+    prefetch->offset = offset;
+    _helix2_prefetch_publish(prefetch);
+}
+
+// Consumer: prefetched keystream bytes ready from the current offset on
+HELIX2_API size_t helix2_prefetch_available(const helix2_prefetch_t* prefetch) {
+    uint64_t head = atomic_load_explicit(&((helix2_prefetch_t *)prefetch)->head, memory_order_acquire);
+    uint64_t block = prefetch->offset / HELIX2_KEYSTREAM_SIZE;
+    if (block < prefetch->valid || block >= head) return 0;
+    return (size_t)((head - block) * HELIX2_KEYSTREAM_SIZE - prefetch->offset % HELIX2_KEYSTREAM_SIZE);
+}
+
+// Start a background producer thread that keeps the ring full, returns false if it could not be started
+//   The thread yields, then sleeps briefly, while the ring is full.
+HELIX2_API bool helix2_prefetch_start(helix2_prefetch_t* prefetch) {
+    if (prefetch->started) return true;
+
+    atomic_store(&prefetch->running, true);
+#ifdef _WIN32
+    prefetch->thread = CreateThread(NULL, 0, _helix2_prefetch_thread, prefetch, 0, NULL);
+    prefetch->started = prefetch->thread != NULL;
+#else
+    prefetch->started = pthread_create(&prefetch->thread, NULL, _helix2_prefetch_thread, prefetch) == 0;
+#endif
+    if (!prefetch->started) atomic_store(&prefetch->running, false);
+    return prefetch->started;
+}
+
+// Stop the background producer thread and wait for it, the prefetched keystream stays usable
+HELIX2_API void helix2_prefetch_stop(helix2_prefetch_t* prefetch) {
+    if (!prefetch->started) return;
+
+    atomic_store(&prefetch->running, false);
+#ifdef _WIN32
+    WaitForSingleObject(prefetch->thread, INFINITE);
+    CloseHandle(prefetch->thread);
+#else
+    pthread_join(prefetch->thread, NULL);
+#endif
+    prefetch->started = false;
+}
+
+// Stop the producer thread and release the ring, the keystream and key schedule are wiped
+HELIX2_API void helix2_prefetch_destroy(helix2_prefetch_t* prefetch) {
+    if (prefetch == NULL) return;
+
+    helix2_prefetch_stop(prefetch);
+    void *allocation = prefetch->allocation;
+    memset(prefetch->ring, 0, prefetch->blocks * HELIX2_KEYSTREAM_SIZE);
+    memset(&prefetch->schedule, 0, sizeof(prefetch->schedule));
+    free(allocation);
+}
+
+
+// Internal helper functions
+// Ring size in blocks for a capacity in bytes, 0 if it does not fit in memory
+static size_t _helix2_prefetch_blocks(size_t capacity) {
+    if (capacity == 0) capacity = _HELIX2_PREFETCH_DEFAULT;
+
+    size_t needed = capacity / HELIX2_KEYSTREAM_SIZE + (capacity % HELIX2_KEYSTREAM_SIZE != 0);
+    size_t blocks = _HELIX2_PREFETCH_MIN_BLOCKS;
+    while (blocks < needed) {
+        if (blocks > SIZE_MAX / 2 / HELIX2_KEYSTREAM_SIZE) return 0;
+        blocks *= 2;
+    }
+    return blocks;
+}
+
+// Hand the blocks before the consumer's offset back to the producer
+static void _helix2_prefetch_publish(helix2_prefetch_t *prefetch) {
+    uint64_t tail = prefetch->offset / HELIX2_KEYSTREAM_SIZE;
+    if (tail > prefetch->valid) prefetch->valid = tail;
+    atomic_store_explicit(&prefetch->tail, tail, memory_order_release);
+}
+
+// Producer thread with nothing to do, yield for a while, then sleep so a full ring does not burn a core
+static void _helix2_prefetch_idle(unsigned int *idle) {
+    if (++*idle < _HELIX2_PREFETCH_SPINS) {
+#ifdef _WIN32
+        SwitchToThread();
+#else
+        sched_yield();
+#endif
+        return;
+    }
+#ifdef _WIN32
+    Sleep(1);
+#else
+    struct timespec pause = { 0, 50 * 1000 };       // 50 us
+    nanosleep(&pause, NULL);
+#endif
+}
+
+// Background producer, fills the ring until helix2_prefetch_stop
+static void _helix2_prefetch_run(helix2_prefetch_t *prefetch) {
+    unsigned int idle = 0;
+
+    while (atomic_load_explicit(&prefetch->running, memory_order_relaxed)) {
+        if (helix2_prefetch_fill(prefetch, 0) > 0) {
+            idle = 0;
+        } else {
+            _helix2_prefetch_idle(&idle);
+        }
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI _helix2_prefetch_thread(LPVOID arg) {
+    _helix2_prefetch_run((helix2_prefetch_t *)arg);
+    return 0;
+}
+#else
+static void *_helix2_prefetch_thread(void *arg) {
+    _helix2_prefetch_run((helix2_prefetch_t *)arg);
+    return NULL;
+}
+#endif
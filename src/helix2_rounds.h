@@ -0,0 +1,120 @@
+/**
+ * @file helix2_rounds.h
+ * @brief Helix2 Stream Cipher, the round function shared by the library and the inline header
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HELIX2_INCL_ROUNDS_H
+#define HELIX2_INCL_ROUNDS_H
+
+// The Helix2 round function, the single definition behind every C keystream path: the scalar engine in helix2.c,
+//   the multi-block engines and the OpenCL kernel (through helix2_internal.h), and helix2_inline.h.
+//   C11 or C++, included by those files rather than by callers.
+
+#include <stdint.h>
+#include <string.h>
+
+// The Helix2 shuffle over any word type T, the engines provide ADD, XOR and ROTL for their vector type
+#define _HELIX2_SHUFFLE(T, s, a, b, c, d, ADD, XOR, ROTL) do {    \
+        T _t;                                                       \
+        _t = ADD(XOR(s[a], s[b]), s[d]); s[c] = ADD(s[c], ROTL(_t, 9));  \
+        _t = XOR(ADD(s[b], s[c]), s[a]); s[d] = XOR(s[d], ROTL(_t, 13)); \
+        _t = ADD(XOR(s[c], s[d]), s[b]); s[a] = ADD(s[a], ROTL(_t, 18)); \
+        _t = XOR(ADD(s[d], s[a]), s[c]); s[b] = XOR(s[b], ROTL(_t, 22)); \
+        _t = ADD(s[a], s[b]); s[c] = XOR(s[c], ROTL(_t, 7));             \
+        _t = XOR(s[b], s[c]); s[d] = ADD(s[d], ROTL(_t, 21));            \
+        _t = ADD(s[c], s[d]); s[a] = XOR(s[a], ROTL(_t, 11));            \
+        _t = XOR(s[d], s[a]); s[b] = ADD(s[b], ROTL(_t, 16));            \
+    } while (0)
+
+// Round 1 row shuffles that only read the key and nonce words (rows 0, 1 and 3)
+//   Row 2 holds the counter, so these results are the same for every block of a key schedule and get cached.
+#define _HELIX2_FIXED_ROWS(T, x, ADD, XOR, ROTL) do {             \
+        _HELIX2_SHUFFLE(T, x, 0,  1,  2,  3,  ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 4,  5,  6,  7,  ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 12, 13, 14, 15, ADD, XOR, ROTL);      \
+    } while (0)
+
+// Add the original state s to the working state x, written out so the scalar words stay in registers
+//   (a loop here gets vectorized in the scalar block function, which then goes through memory).
+#define _HELIX2_ADD_STATE(x, s, ADD) do {                          \
+        x[0]  = ADD(x[0],  s[0]);  x[1]  = ADD(x[1],  s[1]);        \
+        x[2]  = ADD(x[2],  s[2]);  x[3]  = ADD(x[3],  s[3]);        \
+        x[4]  = ADD(x[4],  s[4]);  x[5]  = ADD(x[5],  s[5]);        \
+        x[6]  = ADD(x[6],  s[6]);  x[7]  = ADD(x[7],  s[7]);        \
+        x[8]  = ADD(x[8],  s[8]);  x[9]  = ADD(x[9],  s[9]);        \
+        x[10] = ADD(x[10], s[10]); x[11] = ADD(x[11], s[11]);       \
+        x[12] = ADD(x[12], s[12]); x[13] = ADD(x[13], s[13]);       \
+        x[14] = ADD(x[14], s[14]); x[15] = ADD(x[15], s[15]);       \
+    } while (0)
+
+// Both Helix2 rounds after _HELIX2_FIXED_ROWS, x is the working state and s the original state
+#define _HELIX2_ROUNDS_FROM_ROWS(T, x, s, ADD, XOR, ROTL) do {    \
+        _HELIX2_SHUFFLE(T, x, 8,  9,  10, 11, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 0,  5,  10, 15, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 1,  6,  11, 12, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 2,  7,  8,  13, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 3,  4,  9,  14, ADD, XOR, ROTL);      \
+        _HELIX2_ADD_STATE(x, s, ADD);                               \
+        _HELIX2_SHUFFLE(T, x, 0,  4,  8,  12, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 1,  5,  9,  13, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 2,  6,  10, 14, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 3,  7,  11, 15, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 3,  6,  9,  12, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 2,  5,  8,  15, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 1,  4,  11, 14, ADD, XOR, ROTL);      \
+        _HELIX2_SHUFFLE(T, x, 0,  7,  10, 13, ADD, XOR, ROTL);      \
+        _HELIX2_ADD_STATE(x, s, ADD);                               \
+    } while (0)
+
+// Both Helix2 rounds with their state additions, the row shuffles touch disjoint words so their order is free
+#define _HELIX2_ROUNDS(T, x, s, ADD, XOR, ROTL) do {              \
+        _HELIX2_FIXED_ROWS(T, x, ADD, XOR, ROTL);                   \
+        _HELIX2_ROUNDS_FROM_ROWS(T, x, s, ADD, XOR, ROTL);          \
+    } while (0)
+
+// Word operations of the scalar block function
+#define _HELIX2_ADD32(a, b)     ((uint32_t)((a) + (b)))
+#define _HELIX2_XOR32(a, b)     ((a) ^ (b))
+#define _HELIX2_ROTL32(x, n)    ((uint32_t)(((x) << (n)) | ((x) >> (32 - (n)))))
+#define _HELIX2_SHUFFLE32(s, a, b, c, d) _HELIX2_SHUFFLE(uint32_t, s, a, b, c, d, _HELIX2_ADD32, _HELIX2_XOR32, _HELIX2_ROTL32)
+
+// One keystream block into stream, from a block state (counter words set) and the cached round 1 rows of its key schedule
+static inline void _helix2_rounds_block(const uint32_t *state, const uint32_t *rows, uint32_t *stream) {
+    memcpy(stream, rows, 16 * sizeof(uint32_t));
+    stream[8]  = state[8];  stream[9]  = state[9];
+    stream[10] = state[10]; stream[11] = state[11];
+
+    _HELIX2_ROUNDS_FROM_ROWS(uint32_t, stream, state, _HELIX2_ADD32, _HELIX2_XOR32, _HELIX2_ROTL32);
+}
+
+#endif
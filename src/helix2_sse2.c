@@ -0,0 +1,128 @@
+/**
+ * @file helix2_sse2.c
+ * @brief Helix2 Stream Cipher, SSE2 multi-block keystream engine (4 blocks)
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "helix2_internal.h"
+
+#if defined(HELIX2_ARCH_X86)
+#if !defined(__SSE2__)
+    #error "helix2_sse2.c must be compiled with -msse2"
+#endif
+#include <emmintrin.h>
+
+#define _SSE2_ADD(a, b)  _mm_add_epi32((a), (b))
+#define _SSE2_XOR(a, b)  _mm_xor_si128((a), (b))
+#define _SSE2_ROTL(x, n) _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+
+// Transpose 4 rows of 4 words, turns 4 words of 4 blocks into 4 lane vectors and back
+static inline void _sse2_transpose(__m128i *r) {
+    __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+    __m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+    __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+    __m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+
+    r[0] = _mm_unpacklo_epi64(t0, t1);
+    r[1] = _mm_unpackhi_epi64(t0, t1);
+    r[2] = _mm_unpacklo_epi64(t2, t3);
+    r[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+// Store lane vectors as HELIX2_SSE2_BLOCKS blocks in block layout
+static inline void _sse2_store_blocks(const __m128i *x, uint32_t *out) {
+    for (int i = 0; i < 16; i += 4) {
+        __m128i r[4] = { x[i + 0], x[i + 1], x[i + 2], x[i + 3] };
+        _sse2_transpose(r);
+        for (int j = 0; j < 4; j++) _mm_storeu_si128((__m128i *)&out[j * 16 + i], r[j]);
+    }
+}
+
+// Build HELIX2_SSE2_BLOCKS keystream blocks per iteration, lane j holds block_index + j
+void _helix2_keystream_sse2(const uint32_t *state, const uint32_t *rows, uint32_t nonce_word, uint64_t block_index, uint32_t *out, size_t blocks) {
+    __m128i s[16], r[16], x[16];
+    uint32_t low[HELIX2_SSE2_BLOCKS], high[HELIX2_SSE2_BLOCKS];
+
+    for (int i = 0; i < 16; i++) {
+        s[i] = _mm_set1_epi32((int)state[i]);
+        r[i] = _mm_set1_epi32((int)rows[i]);
+    }
+
+    for (size_t n = 0; n < blocks; n += HELIX2_SSE2_BLOCKS, block_index += HELIX2_SSE2_BLOCKS) {
+        _HELIX2_COUNTERS(low, high, nonce_word, block_index, HELIX2_SSE2_BLOCKS);
+        s[10] = _mm_loadu_si128((const __m128i *)low);
+        s[11] = _mm_loadu_si128((const __m128i *)high);
+
+        // Start from the cached rows, only the counter row is shuffled per block
+        for (int i = 0; i < 16; i++) x[i] = r[i];
+        x[8] = s[8]; x[9] = s[9]; x[10] = s[10]; x[11] = s[11];
+        _HELIX2_ROUNDS_FROM_ROWS(__m128i, x, s, _SSE2_ADD, _SSE2_XOR, _SSE2_ROTL);
+
+        _sse2_store_blocks(x, &out[n * 16]);
+    }
+}
+
+// Build HELIX2_SSE2_BLOCKS keystream blocks from independent block states, lane j runs states[j * 16 ..]
+void _helix2_lanes_sse2(const uint32_t *states, uint32_t *out) {
+    __m128i s[16], x[16];
+
+    for (int i = 0; i < 16; i += 4) {
+        __m128i r[4];
+        for (int j = 0; j < 4; j++) r[j] = _mm_loadu_si128((const __m128i *)&states[j * 16 + i]);
+        _sse2_transpose(r);
+        for (int j = 0; j < 4; j++) s[i + j] = r[j];
+    }
+
+    for (int i = 0; i < 16; i++) x[i] = s[i];
+    _HELIX2_ROUNDS(__m128i, x, s, _SSE2_ADD, _SSE2_XOR, _SSE2_ROTL);
+
+    _sse2_store_blocks(x, out);
+}
+
+// Copy with non-temporal stores, bytes before the first 16-byte aligned dst address go through memcpy
+void _helix2_stream_copy_sse2(uint8_t *dst, const uint8_t *src, size_t size) {
+    size_t head = (16 - ((uintptr_t)dst % 16)) % 16;
+    if (head > size) head = size;
+    memcpy(dst, src, head);
+
+    size_t i = head;
+    for (; i + 16 <= size; i += 16) {
+        _mm_stream_si128((__m128i *)&dst[i], _mm_loadu_si128((const __m128i *)&src[i]));
+    }
+    memcpy(&dst[i], &src[i], size - i);
+}
+
+void _helix2_stream_fence_sse2(void) {
+    _mm_sfence();
+}
+
+#endif
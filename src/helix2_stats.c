@@ -0,0 +1,160 @@
+/**
+ * @file helix2_stats.c
+ * @brief Helix2 Stream Cipher, optional hot path counters
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _HELIX2_EXPORT
+#include "helix2_internal.h"
+
+#if defined(HELIX2_STATS)
+    #include <stdlib.h>
+    #ifdef _WIN32
+        #include <windows.h>
+    #else
+        #include <pthread.h>
+    #endif
+#endif
+
+#if defined(HELIX2_STATS)
+_Thread_local _helix2_stats_slot_t *_helix2_stats_local = NULL;
+
+static _Atomic(_helix2_stats_slot_t *) _helix2_stats_slots = NULL;
+static _helix2_stats_slot_t _helix2_stats_shared;      // threads that could not get a slot of their own
+
+#ifdef _WIN32
+static INIT_ONCE _helix2_stats_once = INIT_ONCE_STATIC_INIT;
+static DWORD _helix2_stats_key = FLS_OUT_OF_INDEXES;
+#else
+static pthread_once_t _helix2_stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _helix2_stats_key;
+static bool _helix2_stats_key_valid = false;
+#endif
+
+// Internal helper function declarations
+static void _helix2_stats_sum(helix2_stats_t *stats, _helix2_stats_slot_t *slot);
+static void _helix2_stats_release(void *slot);
+static void _helix2_stats_watch(_helix2_stats_slot_t *slot);
+#endif
+
+// Exposed functions
+// Add up the counters of every slot, the slots of running threads are read while they count
+HELIX2_API bool helix2_get_stats(helix2_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->backend = helix2_get_backend();
+
+#if defined(HELIX2_STATS)
+    _helix2_stats_sum(stats, &_helix2_stats_shared);
+    for (_helix2_stats_slot_t *slot = atomic_load_explicit(&_helix2_stats_slots, memory_order_acquire); slot != NULL; slot = slot->next) {
+        _helix2_stats_sum(stats, slot);
+        stats->threads++;
+    }
+
+    // The slots are not read at one instant, bytes can run ahead of the blocks they came from
+    uint64_t generated = stats->blocks * HELIX2_KEYSTREAM_SIZE;
+    stats->discarded_bytes = generated > stats->bytes ? generated - stats->bytes : 0;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+#if defined(HELIX2_STATS)
+// Internal helper functions
+// Slot of a thread that has not counted yet, a slot left by a finished thread is taken over with its counters
+//   Slots are never freed, so helix2_get_stats can walk the list without locking and no counts get lost.
+_helix2_stats_slot_t *_helix2_stats_register(void) {
+    _helix2_stats_slot_t *slot;
+    for (slot = atomic_load_explicit(&_helix2_stats_slots, memory_order_acquire); slot != NULL; slot = slot->next) {
+        bool free_slot = false;
+        if (atomic_compare_exchange_strong(&slot->in_use, &free_slot, true)) break;
+    }
+
+    if (slot == NULL) {
+        slot = (_helix2_stats_slot_t *)calloc(1, sizeof(*slot));
+        if (slot == NULL) return &_helix2_stats_shared;
+
+        atomic_init(&slot->in_use, true);
+        slot->next = atomic_load_explicit(&_helix2_stats_slots, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&_helix2_stats_slots, &slot->next, slot, memory_order_release, memory_order_relaxed)) {}
+    }
+
+    _helix2_stats_watch(slot);
+    _helix2_stats_local = slot;
+    return slot;
+}
+
+// Add the counters of one slot
+static void _helix2_stats_sum(helix2_stats_t *stats, _helix2_stats_slot_t *slot) {
+    stats->calls += atomic_load_explicit(&slot->calls, memory_order_relaxed);
+    stats->bytes += atomic_load_explicit(&slot->bytes, memory_order_relaxed);
+    stats->blocks += atomic_load_explicit(&slot->blocks, memory_order_relaxed);
+    stats->partial_blocks += atomic_load_explicit(&slot->partial_blocks, memory_order_relaxed);
+    for (int i = 0; i < HELIX2_BACKEND_COUNT; i++) {
+        stats->backend_blocks[i] += atomic_load_explicit(&slot->backend_blocks[i], memory_order_relaxed);
+    }
+    for (int i = 0; i < HELIX2_STATS_BUCKETS; i++) {
+        stats->size_histogram[i] += atomic_load_explicit(&slot->size_histogram[i], memory_order_relaxed);
+    }
+}
+
+// Hand the slot back when its thread finishes, runs on that thread
+static void _helix2_stats_release(void *slot) {
+    _helix2_stats_local = NULL;
+    atomic_store_explicit(&((_helix2_stats_slot_t *)slot)->in_use, false, memory_order_release);
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK _helix2_stats_key_create(PINIT_ONCE once, PVOID parameter, PVOID *context) {
+    (void)once; (void)parameter; (void)context;
+    _helix2_stats_key = FlsAlloc((PFLS_CALLBACK_FUNCTION)_helix2_stats_release);
+    return TRUE;
+}
+
+// Release the slot at thread exit (fiber local storage callback), a thread without the key keeps its slot
+static void _helix2_stats_watch(_helix2_stats_slot_t *slot) {
+    InitOnceExecuteOnce(&_helix2_stats_once, _helix2_stats_key_create, NULL, NULL);
+    if (_helix2_stats_key != FLS_OUT_OF_INDEXES) FlsSetValue(_helix2_stats_key, slot);
+}
+#else
+static void _helix2_stats_key_create(void) {
+    _helix2_stats_key_valid = pthread_key_create(&_helix2_stats_key, _helix2_stats_release) == 0;
+}
+
+// Release the slot at thread exit (thread-specific data destructor), a thread without the key keeps its slot
+static void _helix2_stats_watch(_helix2_stats_slot_t *slot) {
+    pthread_once(&_helix2_stats_once, _helix2_stats_key_create);
+    if (_helix2_stats_key_valid) pthread_setspecific(_helix2_stats_key, slot);
+}
+#endif
+#endif
@@ -0,0 +1,245 @@
+/**
+ * @file chacha20.c
+ * @brief ChaCha20 reference (RFC 8439), scalar, SSE2 and NEON, for the Helix2 comparative benchmark
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "chacha20.h"
+#include "../src/helix2.h"
+
+#include <string.h>
+
+#if defined(CHACHA20_ARCH_X86) && defined(__SSE2__)
+    #include <emmintrin.h>
+    #define CHACHA20_HAVE_SSE2
+#elif defined(CHACHA20_ARCH_NEON)
+    #include <arm_neon.h>
+#endif
+
+typedef void (*_chacha20_blocks_fn)(const uint32_t *state, uint32_t counter, uint32_t *out, size_t blocks);
+
+static void _chacha20_blocks_scalar(const uint32_t *state, uint32_t counter, uint32_t *out, size_t blocks);
+static _chacha20_blocks_fn _chacha20_engine(chacha20_backend_t backend, size_t *width);
+
+static inline uint32_t _chacha20_load32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 32-byte key and 12-byte nonce as in RFC 8439, the counter comes from the keystream offset
+void chacha20_initialize_key(chacha20_key_t *key, const uint8_t *key_bytes, const uint8_t *nonce) {
+    key->state[0] = 0x61707865u;
+    key->state[1] = 0x3320646eu;
+    key->state[2] = 0x79622d32u;
+    key->state[3] = 0x6b206574u;
+    for (int i = 0; i < 8; i++) key->state[4 + i] = _chacha20_load32(&key_bytes[i * 4]);
+    key->state[12] = 0;
+    for (int i = 0; i < 3; i++) key->state[13 + i] = _chacha20_load32(&nonce[i * 4]);
+}
+
+// dst = src ^ keystream from start_offset (dst == src is fine), src NULL writes the raw keystream
+//   Same shape as helix2_key_buffer_copy / helix2_key_keystream so both ciphers go through identical loops.
+void chacha20_xor(const chacha20_key_t *key, chacha20_backend_t backend, uint8_t *dst, const uint8_t *src, size_t size, uint64_t start_offset) {
+    uint32_t stream[CHACHA20_MAX_BLOCKS * 16];
+    size_t width;
+    _chacha20_blocks_fn blocks = _chacha20_engine(backend, &width);
+
+    uint32_t counter = (uint32_t)(start_offset / CHACHA20_BLOCK_SIZE);
+    size_t skip = (size_t)(start_offset % CHACHA20_BLOCK_SIZE);
+    size_t done = 0;
+
+    while (done < size) {
+        // Whole batches while they fit, single blocks for the tail
+        size_t run = skip + (size - done) >= width * CHACHA20_BLOCK_SIZE ? width : 1;
+        if (run == 1) _chacha20_blocks_scalar(key->state, counter, stream, 1);
+        else blocks(key->state, counter, stream, run);
+        counter += (uint32_t)run;
+
+        const uint8_t *ks = (const uint8_t *)stream + skip;
+        size_t length = run * CHACHA20_BLOCK_SIZE - skip;
+        if (length > size - done) length = size - done;
+        skip = 0;
+
+        if (!src) {
+            memcpy(&dst[done], ks, length);
+        } else {
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8) {
+                uint64_t a, b;
+                memcpy(&a, &src[done + i], 8);
+                memcpy(&b, &ks[i], 8);
+                a ^= b;
+                memcpy(&dst[done + i], &a, 8);
+            }
+            for (; i < length; i++) dst[done + i] = src[done + i] ^ ks[i];
+        }
+        done += length;
+    }
+}
+
+int chacha20_backend_supported(chacha20_backend_t backend) {
+    switch (backend) {
+        case CHACHA20_SCALAR: return 1;
+#ifdef CHACHA20_HAVE_SSE2
+        case CHACHA20_SSE2: return 1;
+#endif
+#ifdef CHACHA20_ARCH_X86
+        case CHACHA20_AVX2: return helix2_backend_supported(HELIX2_BACKEND_AVX2);
+#endif
+#ifdef CHACHA20_ARCH_NEON
+        case CHACHA20_NEON: return 1;
+#endif
+        default: return 0;
+    }
+}
+
+// Same names as helix2_backend_name, so rows of both ciphers pair up
+const char *chacha20_backend_name(chacha20_backend_t backend) {
+    static const char *names[CHACHA20_BACKENDS] = { "scalar", "sse2", "avx2", "neon" };
+    return backend < CHACHA20_BACKENDS ? names[backend] : "unknown";
+}
+
+// RFC 8439 section 2.4.2 (key 00..1f, counter 1), then every backend against the scalar code at odd offsets
+int chacha20_self_test(void) {
+    static const uint8_t expected[16] = {
+        0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81
+    };
+    static const uint8_t tail[6] = { 0xf2, 0x78, 0x5e, 0x42, 0x87, 0x4d };
+    static const char plaintext[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+    uint8_t key_bytes[32], nonce[12] = { 0, 0, 0, 0, 0, 0, 0, 0x4a, 0, 0, 0, 0 };
+    uint8_t text[sizeof(plaintext) - 1];
+    chacha20_key_t key;
+
+    for (int i = 0; i < 32; i++) key_bytes[i] = (uint8_t)i;
+    chacha20_initialize_key(&key, key_bytes, nonce);
+
+    for (int b = 0; b < CHACHA20_BACKENDS; b++) {
+        if (!chacha20_backend_supported((chacha20_backend_t)b)) continue;
+        chacha20_xor(&key, (chacha20_backend_t)b, text, (const uint8_t *)plaintext, sizeof(text), CHACHA20_BLOCK_SIZE);
+        if (memcmp(text, expected, 16) != 0 || memcmp(&text[sizeof(text) - 6], tail, 6) != 0) return 0;
+    }
+
+    static uint8_t reference[3000], output[3000];
+    const size_t offsets[] = { 0, 1, 63, 64, 640, 1000 };
+    for (int b = 1; b < CHACHA20_BACKENDS; b++) {
+        if (!chacha20_backend_supported((chacha20_backend_t)b)) continue;
+        for (int o = 0; o < 6; o++) {
+            chacha20_xor(&key, CHACHA20_SCALAR, reference, NULL, sizeof(reference), offsets[o]);
+            chacha20_xor(&key, (chacha20_backend_t)b, output, NULL, sizeof(output), offsets[o]);
+            if (memcmp(reference, output, sizeof(output)) != 0) return 0;
+        }
+    }
+    return 1;
+}
+
+// One block at a time
+static void _chacha20_blocks_scalar(const uint32_t *state, uint32_t counter, uint32_t *out, size_t blocks) {
+    #define _SCALAR_ADD(a, b)  ((a) + (b))
+    #define _SCALAR_XOR(a, b)  ((a) ^ (b))
+    #define _SCALAR_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+    uint32_t s[16], x[16];
+    memcpy(s, state, sizeof(s));
+
+    for (size_t n = 0; n < blocks; n++) {
+        s[12] = counter + (uint32_t)n;
+        CHACHA20_ROUNDS(x, s, _SCALAR_ADD, _SCALAR_XOR, _SCALAR_ROTL);
+        memcpy(&out[n * 16], x, sizeof(x));
+    }
+}
+
+#ifdef CHACHA20_HAVE_SSE2
+// Four blocks per iteration, vector i holds word i of the four blocks
+static void _chacha20_blocks_sse2(const uint32_t *state, uint32_t counter, uint32_t *out, size_t blocks) {
+    #define _SSE2_ADD(a, b)  _mm_add_epi32((a), (b))
+    #define _SSE2_XOR(a, b)  _mm_xor_si128((a), (b))
+    #define _SSE2_ROTL(x, n) _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+    __m128i s[16], x[16];
+    for (int i = 0; i < 16; i++) s[i] = _mm_set1_epi32((int)state[i]);
+
+    for (size_t n = 0; n < blocks; n += 4) {
+        uint32_t c = counter + (uint32_t)n;
+        s[12] = _mm_set_epi32((int)(c + 3), (int)(c + 2), (int)(c + 1), (int)c);
+        CHACHA20_ROUNDS(x, s, _SSE2_ADD, _SSE2_XOR, _SSE2_ROTL);
+
+        for (int i = 0; i < 16; i += 4) {
+            __m128i t0 = _mm_unpacklo_epi32(x[i + 0], x[i + 1]);
+            __m128i t1 = _mm_unpacklo_epi32(x[i + 2], x[i + 3]);
+            __m128i t2 = _mm_unpackhi_epi32(x[i + 0], x[i + 1]);
+            __m128i t3 = _mm_unpackhi_epi32(x[i + 2], x[i + 3]);
+            _mm_storeu_si128((__m128i *)&out[(n + 0) * 16 + i], _mm_unpacklo_epi64(t0, t1));
+            _mm_storeu_si128((__m128i *)&out[(n + 1) * 16 + i], _mm_unpackhi_epi64(t0, t1));
+            _mm_storeu_si128((__m128i *)&out[(n + 2) * 16 + i], _mm_unpacklo_epi64(t2, t3));
+            _mm_storeu_si128((__m128i *)&out[(n + 3) * 16 + i], _mm_unpackhi_epi64(t2, t3));
+        }
+    }
+}
+#endif
+
+#ifdef CHACHA20_ARCH_NEON
+// Four blocks per iteration, same layout as the SSE2 engine
+static void _chacha20_blocks_neon(const uint32_t *state, uint32_t counter, uint32_t *out, size_t blocks) {
+    #define _NEON_ADD(a, b)  vaddq_u32((a), (b))
+    #define _NEON_XOR(a, b)  veorq_u32((a), (b))
+    #define _NEON_ROTL(x, n) vorrq_u32(vshlq_n_u32((x), (n)), vshrq_n_u32((x), 32 - (n)))
+    uint32x4_t s[16], x[16];
+    for (int i = 0; i < 16; i++) s[i] = vdupq_n_u32(state[i]);
+
+    for (size_t n = 0; n < blocks; n += 4) {
+        uint32_t c[4] = { counter + (uint32_t)n, counter + (uint32_t)n + 1, counter + (uint32_t)n + 2, counter + (uint32_t)n + 3 };
+        s[12] = vld1q_u32(c);
+        CHACHA20_ROUNDS(x, s, _NEON_ADD, _NEON_XOR, _NEON_ROTL);
+
+        for (int i = 0; i < 16; i += 4) {
+            uint32x4x2_t t01 = vtrnq_u32(x[i + 0], x[i + 1]);
+            uint32x4x2_t t23 = vtrnq_u32(x[i + 2], x[i + 3]);
+            vst1q_u32(&out[(n + 0) * 16 + i], vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0])));
+            vst1q_u32(&out[(n + 1) * 16 + i], vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1])));
+            vst1q_u32(&out[(n + 2) * 16 + i], vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0])));
+            vst1q_u32(&out[(n + 3) * 16 + i], vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1])));
+        }
+    }
+}
+#endif
+
+static _chacha20_blocks_fn _chacha20_engine(chacha20_backend_t backend, size_t *width) {
+    switch (backend) {
+#ifdef CHACHA20_HAVE_SSE2
+        case CHACHA20_SSE2: *width = 4; return _chacha20_blocks_sse2;
+#endif
+#ifdef CHACHA20_ARCH_X86
+        case CHACHA20_AVX2: *width = 8; return _chacha20_blocks_avx2;
+#endif
+#ifdef CHACHA20_ARCH_NEON
+        case CHACHA20_NEON: *width = 4; return _chacha20_blocks_neon;
+#endif
+        default: *width = 1; return _chacha20_blocks_scalar;
+    }
+}
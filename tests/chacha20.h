@@ -0,0 +1,100 @@
+/**
+ * @file chacha20.h
+ * @brief ChaCha20 reference for the Helix2 comparative benchmark
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHACHA20_BENCH_H
+#define CHACHA20_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ChaCha20 (RFC 8439) baseline for helix2_performance, built into the benchmark only, not part of libhelix2
+
+#define CHACHA20_BLOCK_SIZE 64
+#define CHACHA20_MAX_BLOCKS 8               // widest backend (AVX2)
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define CHACHA20_ARCH_X86
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define CHACHA20_ARCH_NEON
+#endif
+
+// Constant, key, block counter (word 12, set per block) and 96-bit nonce
+typedef struct
+{
+    uint32_t state[16];
+} chacha20_key_t;
+
+typedef enum
+{
+    CHACHA20_SCALAR = 0,
+    CHACHA20_SSE2,
+    CHACHA20_AVX2,
+    CHACHA20_NEON,
+    CHACHA20_BACKENDS
+} chacha20_backend_t;
+
+// The 20 rounds plus the final addition on 16 words (scalars or vectors of one word from several blocks)
+#define CHACHA20_QUARTER(x, a, b, c, d, ADD, XOR, ROTL) \
+    x[a] = ADD(x[a], x[b]); x[d] = XOR(x[d], x[a]); x[d] = ROTL(x[d], 16); \
+    x[c] = ADD(x[c], x[d]); x[b] = XOR(x[b], x[c]); x[b] = ROTL(x[b], 12); \
+    x[a] = ADD(x[a], x[b]); x[d] = XOR(x[d], x[a]); x[d] = ROTL(x[d], 8);  \
+    x[c] = ADD(x[c], x[d]); x[b] = XOR(x[b], x[c]); x[b] = ROTL(x[b], 7)
+
+#define CHACHA20_ROUNDS(x, s, ADD, XOR, ROTL) \
+    do { \
+        for (int i = 0; i < 16; i++) x[i] = s[i]; \
+        for (int round = 0; round < 10; round++) { \
+            CHACHA20_QUARTER(x, 0, 4,  8, 12, ADD, XOR, ROTL); \
+            CHACHA20_QUARTER(x, 1, 5,  9, 13, ADD, XOR, ROTL); \
+            CHACHA20_QUARTER(x, 2, 6, 10, 14, ADD, XOR, ROTL); \
+            CHACHA20_QUARTER(x, 3, 7, 11, 15, ADD, XOR, ROTL); \
+            CHACHA20_QUARTER(x, 0, 5, 10, 15, ADD, XOR, ROTL); \
+            CHACHA20_QUARTER(x, 1, 6, 11, 12, ADD, XOR, ROTL); \
+            CHACHA20_QUARTER(x, 2, 7,  8, 13, ADD, XOR, ROTL); \
+            CHACHA20_QUARTER(x, 3, 4,  9, 14, ADD, XOR, ROTL); \
+        } \
+        for (int i = 0; i < 16; i++) x[i] = ADD(x[i], s[i]); \
+    } while (0)
+
+void chacha20_initialize_key(chacha20_key_t *key, const uint8_t *key_bytes, const uint8_t *nonce);
+void chacha20_xor(const chacha20_key_t *key, chacha20_backend_t backend, uint8_t *dst, const uint8_t *src, size_t size, uint64_t start_offset);
+int chacha20_backend_supported(chacha20_backend_t backend);
+const char *chacha20_backend_name(chacha20_backend_t backend);
+int chacha20_self_test(void);
+
+// Multi-block engines, blocks is a multiple of their width
+void _chacha20_blocks_avx2(const uint32_t *state, uint32_t counter, uint32_t *out, size_t blocks);
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file chacha20_avx2.c
+ * @brief ChaCha20 reference, 8-block AVX2 engine for the Helix2 comparative benchmark
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "chacha20.h"
+
+#if defined(CHACHA20_ARCH_X86)
+#if !defined(__AVX2__)
+    #error "chacha20_avx2.c must be compiled with -mavx2"
+#endif
+#include <immintrin.h>
+
+#define _AVX2_ADD(a, b)  _mm256_add_epi32((a), (b))
+#define _AVX2_XOR(a, b)  _mm256_xor_si256((a), (b))
+#define _AVX2_ROTL(x, n) _avx2_rotl((x), (n))
+
+// 16 and 8 bit rotations are byte shuffles, the others shifts
+static inline __m256i _avx2_rotl(__m256i x, int n) {
+    if (n == 16) {
+        return _mm256_shuffle_epi8(x, _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+                                                      13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+    }
+    if (n == 8) {
+        return _mm256_shuffle_epi8(x, _mm256_set_epi8(14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3,
+                                                      14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3));
+    }
+    return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+}
+
+// Eight blocks per iteration, vector i holds word i of the eight blocks
+void _chacha20_blocks_avx2(const uint32_t *state, uint32_t counter, uint32_t *out, size_t blocks) {
+    __m256i s[16], x[16];
+    for (int i = 0; i < 16; i++) s[i] = _mm256_set1_epi32((int)state[i]);
+
+    for (size_t n = 0; n < blocks; n += 8) {
+        s[12] = _mm256_add_epi32(_mm256_set1_epi32((int)(counter + (uint32_t)n)), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+        CHACHA20_ROUNDS(x, s, _AVX2_ADD, _AVX2_XOR, _AVX2_ROTL);
+
+        // Transpose 4x4 words within each 128-bit half, the low half holds blocks 0-3, the high half blocks 4-7
+        for (int i = 0; i < 16; i += 4) {
+            __m256i t0 = _mm256_unpacklo_epi32(x[i + 0], x[i + 1]);
+            __m256i t1 = _mm256_unpacklo_epi32(x[i + 2], x[i + 3]);
+            __m256i t2 = _mm256_unpackhi_epi32(x[i + 0], x[i + 1]);
+            __m256i t3 = _mm256_unpackhi_epi32(x[i + 2], x[i + 3]);
+            __m256i r[4] = { _mm256_unpacklo_epi64(t0, t1), _mm256_unpackhi_epi64(t0, t1),
+                             _mm256_unpacklo_epi64(t2, t3), _mm256_unpackhi_epi64(t2, t3) };
+            for (int j = 0; j < 4; j++) {
+                _mm_storeu_si128((__m128i *)&out[(n + j) * 16 + i], _mm256_castsi256_si128(r[j]));
+                _mm_storeu_si128((__m128i *)&out[(n + j + 4) * 16 + i], _mm256_extracti128_si256(r[j], 1));
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,87 @@
+/**
+ * @file helix2_hpp_test.cpp
+ * @brief Helix2 Stream Cipher, tests of the C++ header kernels against the C library
+ * 
+ * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
+ * ChaCha20 but using nested operations for higher per-operation complexity.
+ * 
+ * WARNING: This cipher is experimental and has NOT undergone formal 
+ * cryptanalysis. It should NOT be used for production security applications.
+ * 
+ * @author Jarl "Yamakuku" Lindeneg
+ * @version 2.2
+ * 
+ * @copyright Copyright (c) 2025 Jarl "Yamakuku" Lindeneg
+ * @license MIT License
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "../src/helix2.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+
+static const std::uint8_t key[32] = {
+    0x78, 0x56, 0x34, 0x12, 0x01, 0xEF, 0xCD, 0xAB, 0x11, 0x11, 0x11, 0x11, 0x22, 0x22, 0x22, 0x22,
+    0x33, 0x33, 0x33, 0x33, 0x44, 0x44, 0x44, 0x44, 0x55, 0x55, 0x55, 0x55, 0x66, 0x66, 0x66, 0x66
+};
+static const std::uint8_t nonce[20] = { 0x0C, 0x0B, 0x0A, 0x09, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 7 };
+
+// Kernel output against helix2_key_keystream, across the 32-bit counter carry
+template <std::size_t Blocks, typename O = typename helix2::detail::ops_for<Blocks>::type>
+static void test_kernel(const helix2_key_t& schedule) {
+    std::uint32_t expected[Blocks * 16], out[Blocks * 16];
+    std::uint64_t starts[] = { 0, 1, 0xFFFFFFFFull - Blocks / 2, 0x123456789ull };
+
+    for (std::uint64_t start : starts) {
+        helix2_key_keystream(&schedule, (std::uint8_t*)expected, sizeof(expected), start * HELIX2_KEYSTREAM_SIZE);
+        helix2::keystream_blocks<Blocks, O>(schedule, start, out);
+        assert(std::memcmp(expected, out, sizeof(out)) == 0);
+    }
+    std::printf("Kernel %2zu blocks: OK\n", Blocks);
+}
+
+static void test_key_buffer(const helix2_key_t& schedule) {
+    static std::uint8_t expected[5000], data[5000];
+    std::uint64_t offsets[] = { 0, 5, 64, 0xFFFFFFFFull * 64 - 100 };
+
+    for (std::uint64_t offset : offsets) {
+        for (int i = 0; i < 5000; i++) expected[i] = data[i] = (std::uint8_t)(i * 7);
+        helix2_key_buffer(&schedule, expected, sizeof(expected), offset);
+        helix2::key_buffer<8>(schedule, data, sizeof(data), offset);
+        assert(std::memcmp(expected, data, sizeof(data)) == 0);
+    }
+    std::printf("key_buffer: OK\n");
+}
+
+int main() {
+    helix2_key_t schedule;
+    helix2_initialize_key(&schedule, key, nonce);
+
+    test_kernel<1>(schedule);
+    test_kernel<4>(schedule);
+    test_kernel<8>(schedule);
+    test_kernel<16>(schedule);
+    test_kernel<4, helix2::detail::lanes_ops<4>>(schedule);
+    test_key_buffer(schedule);
+
+    std::printf("All C++ header tests passed successfully.\n");
+    return 0;
+}
@@ -1,6 +1,6 @@
 /**
  * @file helix2.c
- * @brief Helix2 Stream Cipher implementation, simple performance test example
+ * @brief Helix2 Stream Cipher implementation, benchmark harness
  * 
  * Helix2-cipher is an educational ARX (Add-Rotate-XOR) stream cipher inspired by
  * ChaCha20 but using nested operations for higher per-operation complexity.
@@ -34,70 +34,662 @@
  * SOFTWARE.
  */
 
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L     // clock_gettime, sysconf
+#endif
+
 #include "../src/helix2.h"
+#include "../src/helix2_inline.h"
+#include "chacha20.h"
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
 #include <stdlib.h>
-#include <assert.h>
+#include <inttypes.h>
 
-int main(int argc, char *argv[]);
-double benchmark_throughput(size_t buffer_size, int iterations);
-void test_performance();
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+// Cycle counter: the TSC on x86 (reference cycles), the virtual counter on AArch64 (fixed frequency ticks)
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    #define BENCH_TICKS_NAME "rdtsc"
+#elif defined(__aarch64__)
+    #define BENCH_TICKS_NAME "cntvct"
+#else
+    #define BENCH_TICKS_NAME "none"
+#endif
+
+#define BENCH_MAX_TRIALS 1001
+#define BENCH_RECORDS 64                    // messages per batch call
+#define BENCH_PARALLEL_SIZE (16 * 1024 * 1024)
+#define BENCH_MAX_SIZE (1024 * 1024)
+#define BENCH_MAX_ROWS 512
+#define BENCH_MAX_THREADS 64
+
+enum { FORMAT_TEXT, FORMAT_JSON, FORMAT_CSV };
+
+typedef void (*bench_fn)(void *arg);
+
+// Run options, set from the command line
+typedef struct
+{
+    int trials;
+    double warmup_ms;                       // warmup also calibrates the calls per trial
+    double trial_ms;
+    int format;
+    unsigned int max_threads;
+    int helix2;                             // ciphers to run, --cipher
+    int chacha20;
+    FILE *out;
+    int rows;                               // rows written so far (JSON separators)
+} bench_options_t;
+
+// Statistics over the trials of one row
+typedef struct
+{
+    double mbps_median;
+    double mbps_min;
+    double mbps_max;
+    double cpb_median;                      // ticks per byte, 0 without a counter
+    double latency_median_ns;               // per call
+    double latency_p99_ns;
+    uint64_t calls;                         // per trial
+} bench_result_t;
 
-double benchmark_throughput(size_t buffer_size, int iterations) {
+// A reported row, kept for the Helix2 / ChaCha20 comparison
+typedef struct
+{
+    const char *cipher;
+    const char *api;
+    const char *backend;
+    size_t size;
+    unsigned int threads;
+    bench_result_t result;
+} bench_row_t;
+
+// One API under test, everything a bench_fn needs
+typedef struct
+{
     helix2_context_t ctx;
-    uint8_t key[32] = {0};
-    uint8_t nonce[20] = {0};
-    
-    // Initialize with test key
-    for (int i = 0; i < 32; i++) key[i] = i;
-    helix2_initialize_context(&ctx, key, nonce);
-    
-    uint8_t *buffer = malloc(buffer_size);
-    if (!buffer) return 0.0;
-    memset(buffer, 0, buffer_size);
-    
-    clock_t start = clock();
-    
-    for (int i = 0; i < iterations; i++) {
-        helix2_buffer(&ctx, buffer, buffer_size, (uint64_t)i * buffer_size);
-    }
-    
-    clock_t end = clock();
-    double seconds = (double)(end - start) / CLOCKS_PER_SEC;
-    double mb_processed = (iterations * buffer_size) / (1024.0 * 1024.0);
-    
-    free(buffer);
-    return mb_processed / seconds; // MB/s
-}
-
-void test_performance() {
-    printf("\nHelix2 Performance Benchmark\n");
-    printf("==============================\n\n");
-    
-    // Test different buffer sizes
-    size_t sizes[] = {64, 256, 1024, 4096, 16384, 65536, 1024*1024};
-    const char* size_names[] = {"64 B", "256 B", "1 KB", "4 KB", "16 KB", "64 KB", "1 MB"};
-    
-    for (int i = 0; i < 7; i++) {
-        int iterations = (1024 * 1024 * 100) / sizes[i]; // Process ~100 MB
-        if (iterations < 10) iterations = 10;
-        
-        double throughput = benchmark_throughput(sizes[i], iterations);
-        printf("Buffer: %-6s  Throughput: %7.2f MB/s", size_names[i], throughput);
-        
-        if (throughput > 1024) {
-            printf("  (%5.2f GB/s)", throughput / 1024.0);
+    helix2_key_t schedule;
+    uint8_t key[32];
+    uint8_t *buffer;
+    uint8_t *dst;
+    size_t size;
+    uint64_t offset;
+    helix2_parallel_t parallel;
+    uint8_t nonces[BENCH_RECORDS][20];
+    helix2_message_t messages[BENCH_RECORDS];
+    helix2_key_t sessions[BENCH_RECORDS];  // one key per message, the multi-key rows
+    helix2_key_message_t session_messages[BENCH_RECORDS];
+    chacha20_key_t chacha;                  // the ChaCha20 baseline uses the first 12 bytes of each nonce
+    chacha20_backend_t chacha_backend;
+    unsigned int threads;
+} bench_work_t;
+
+// One thread's share of a ChaCha20 parallel call
+typedef struct
+{
+    bench_work_t *work;
+    size_t begin;
+    size_t end;
+} bench_chunk_t;
+
+static bench_row_t bench_rows[BENCH_MAX_ROWS];
+static int bench_row_count;
+
+int main(int argc, char *argv[]);
+void test_performance(bench_options_t *options);
+uint64_t bench_now_ns(void);
+uint64_t bench_ticks(void);
+unsigned int bench_cpu_count(void);
+void bench_measure(const bench_options_t *options, bench_fn fn, void *arg, size_t bytes_per_call, bench_result_t *result);
+void bench_report(bench_options_t *options, const char *cipher, const char *api, const char *backend, size_t size, unsigned int threads, const bench_result_t *result);
+void bench_begin(bench_options_t *options);
+void bench_end(bench_options_t *options);
+void bench_work_init(bench_work_t *work, size_t size);
+void bench_run(bench_options_t *options, const char *cipher, const char *api, const char *backend, bench_fn fn, bench_work_t *work, size_t size, size_t bytes_per_call, unsigned int threads);
+void bench_compare_ciphers(bench_options_t *options);
+int bench_compare(const void *a, const void *b);
+void api_buffer(void *arg);
+void api_key_buffer(void *arg);
+void api_key_buffer_copy(void *arg);
+void api_key_buffer_inline(void *arg);
+void api_keystream(void *arg);
+void api_records(void *arg);
+void api_batch(void *arg);
+void api_sessions(void *arg);
+void api_multi(void *arg);
+void api_parallel(void *arg);
+void api_chacha20_xor(void *arg);
+void api_chacha20_copy(void *arg);
+void api_chacha20_keystream(void *arg);
+void api_chacha20_records(void *arg);
+void api_chacha20_parallel(void *arg);
+
+// Monotonic wall clock
+uint64_t bench_now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+#endif
+}
+
+uint64_t bench_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return 0;
+#endif
+}
+
+unsigned int bench_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+#endif
+}
+
+int bench_compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Warm up (caches, branch predictors, CPU clock) while counting how many calls fill trial_ms, then time the trials
+void bench_measure(const bench_options_t *options, bench_fn fn, void *arg, size_t bytes_per_call, bench_result_t *result) {
+    static double mbps[BENCH_MAX_TRIALS], cpb[BENCH_MAX_TRIALS], latency[BENCH_MAX_TRIALS];
+
+    uint64_t warmup_calls = 0;
+    uint64_t start = bench_now_ns(), elapsed;
+    do {
+        fn(arg);
+        warmup_calls++;
+        elapsed = bench_now_ns() - start;
+    } while (elapsed < (uint64_t)(options->warmup_ms * 1e6));
+
+    uint64_t calls = (uint64_t)((double)warmup_calls * options->trial_ms / ((double)elapsed / 1e6));
+    if (calls == 0) calls = 1;
+
+    for (int t = 0; t < options->trials; t++) {
+        uint64_t t0 = bench_now_ns();
+        uint64_t k0 = bench_ticks();
+        for (uint64_t c = 0; c < calls; c++) fn(arg);
+        uint64_t k1 = bench_ticks();
+        uint64_t ns = bench_now_ns() - t0;
+        if (ns == 0) ns = 1;
+
+        double bytes = (double)bytes_per_call * (double)calls;
+        mbps[t] = bytes / ((double)ns / 1e9) / (1024.0 * 1024.0);
+        cpb[t] = (double)(k1 - k0) / bytes;
+        latency[t] = (double)ns / (double)calls;
+    }
+
+    int n = options->trials;
+    qsort(mbps, n, sizeof(double), bench_compare);
+    qsort(cpb, n, sizeof(double), bench_compare);
+    qsort(latency, n, sizeof(double), bench_compare);
+
+    // Nearest-rank percentiles, with few trials p99 is the slowest trial
+    int p99 = (99 * n + 99) / 100 - 1;
+    result->mbps_median = mbps[n / 2];
+    result->mbps_min = mbps[0];
+    result->mbps_max = mbps[n - 1];
+    result->cpb_median = cpb[n / 2];
+    result->latency_median_ns = latency[n / 2];
+    result->latency_p99_ns = latency[p99];
+    result->calls = calls;
+}
+
+void bench_begin(bench_options_t *options) {
+    if (options->format == FORMAT_JSON) {
+        fprintf(options->out, "{\n  \"benchmark\": \"helix2_performance\",\n");
+        fprintf(options->out, "  \"host\": { \"cpus\": %u, \"backend\": \"%s\", \"ticks\": \"%s\" },\n",
+                bench_cpu_count(), helix2_backend_name(helix2_get_backend()), BENCH_TICKS_NAME);
+        fprintf(options->out, "  \"options\": { \"trials\": %d, \"warmup_ms\": %.1f, \"trial_ms\": %.1f },\n",
+                options->trials, options->warmup_ms, options->trial_ms);
+        fprintf(options->out, "  \"results\": [\n");
+    } else if (options->format == FORMAT_CSV) {
+        fprintf(options->out, "cipher,api,backend,size,threads,trials,calls,mbps_median,mbps_min,mbps_max,cpb_median,latency_ns_median,latency_ns_p99\n");
+    } else {
+        fprintf(options->out, "\nHelix2 Performance Benchmark\n");
+        fprintf(options->out, "==============================\n\n");
+        fprintf(options->out, "CPUs: %u  Backend: %s  Cycles: %s  Trials: %d x %.0f ms\n\n",
+                bench_cpu_count(), helix2_backend_name(helix2_get_backend()), BENCH_TICKS_NAME, options->trials, options->trial_ms);
+        fprintf(options->out, "%-8s %-20s %-8s %8s %4s %12s %12s %8s %12s %12s\n",
+                "cipher", "api", "backend", "size", "thr", "median MB/s", "min MB/s", "cpb", "latency", "p99");
+    }
+}
+
+void bench_end(bench_options_t *options) {
+    if (options->format == FORMAT_JSON) fprintf(options->out, "\n  ]");
+    bench_compare_ciphers(options);
+    if (options->format == FORMAT_JSON) fprintf(options->out, "\n}\n");
+    else if (options->format == FORMAT_TEXT) fprintf(options->out, "\n");
+}
+
+// Helix2 against ChaCha20 for every pair of rows with the same API, size, threads and backend
+//   The thread scaling rows pair up whatever backend each cipher picked as its best. CSV keeps one row format only.
+void bench_compare_ciphers(bench_options_t *options) {
+    int pairs = 0;
+    if (options->format == FORMAT_CSV) return;
+
+    for (int c = 0; c < bench_row_count; c++) {
+        const bench_row_t *chacha = &bench_rows[c];
+        if (strcmp(chacha->cipher, "chacha20") != 0) continue;
+
+        for (int h = 0; h < bench_row_count; h++) {
+            const bench_row_t *helix = &bench_rows[h];
+            int parallel = strcmp(chacha->api, "key_buffer_parallel") == 0;
+            if (strcmp(helix->cipher, "helix2") != 0 || strcmp(helix->api, chacha->api) != 0 ||
+                helix->size != chacha->size || helix->threads != chacha->threads ||
+                (!parallel && strcmp(helix->backend, chacha->backend) != 0)) continue;
+
+            double speedup = helix->result.mbps_median / chacha->result.mbps_median;
+            double latency = helix->result.latency_median_ns / chacha->result.latency_median_ns;
+            if (options->format == FORMAT_JSON) {
+                fprintf(options->out, "%s    { \"api\": \"%s\", \"backend\": \"%s\", \"chacha20_backend\": \"%s\", \"size\": %zu, \"threads\": %u, "
+                                      "\"helix2_mbps\": %.2f, \"chacha20_mbps\": %.2f, \"speedup\": %.3f, \"latency_ratio\": %.3f }",
+                        pairs ? ",\n" : ",\n  \"comparison\": [\n", chacha->api, helix->backend, chacha->backend, chacha->size,
+                        chacha->threads, helix->result.mbps_median, chacha->result.mbps_median, speedup, latency);
+            } else {
+                if (pairs == 0) {
+                    fprintf(options->out, "\nHelix2 vs ChaCha20 (median throughput and latency per call)\n\n");
+                    fprintf(options->out, "%-20s %-15s %8s %4s %12s %12s %9s %9s\n",
+                            "api", "backend", "size", "thr", "helix2 MB/s", "chacha MB/s", "speedup", "latency");
+                }
+                char backend[32];
+                if (strcmp(helix->backend, chacha->backend) == 0) snprintf(backend, sizeof(backend), "%s", helix->backend);
+                else snprintf(backend, sizeof(backend), "%s/%s", helix->backend, chacha->backend);
+                fprintf(options->out, "%-20s %-15s %8zu %4u %12.2f %12.2f %8.2fx %8.2fx\n",
+                        chacha->api, backend, chacha->size, chacha->threads, helix->result.mbps_median,
+                        chacha->result.mbps_median, speedup, latency);
+            }
+            pairs++;
+        }
+    }
+    if (options->format == FORMAT_JSON && pairs) fprintf(options->out, "\n  ]");
+}
+
+void bench_report(bench_options_t *options, const char *cipher, const char *api, const char *backend, size_t size, unsigned int threads, const bench_result_t *result) {
+    FILE *out = options->out;
+    if (options->format == FORMAT_JSON) {
+        fprintf(out, "%s    { \"cipher\": \"%s\", \"api\": \"%s\", \"backend\": \"%s\", \"size\": %zu, \"threads\": %u, "
+                     "\"trials\": %d, \"calls\": %" PRIu64 ", \"mbps_median\": %.2f, \"mbps_min\": %.2f, \"mbps_max\": %.2f, "
+                     "\"cpb_median\": %.3f, \"latency_ns_median\": %.1f, \"latency_ns_p99\": %.1f }",
+                options->rows ? ",\n" : "", cipher, api, backend, size, threads, options->trials, result->calls,
+                result->mbps_median, result->mbps_min, result->mbps_max, result->cpb_median,
+                result->latency_median_ns, result->latency_p99_ns);
+    } else if (options->format == FORMAT_CSV) {
+        fprintf(out, "%s,%s,%s,%zu,%u,%d,%" PRIu64 ",%.2f,%.2f,%.2f,%.3f,%.1f,%.1f\n",
+                cipher, api, backend, size, threads, options->trials, result->calls,
+                result->mbps_median, result->mbps_min, result->mbps_max, result->cpb_median,
+                result->latency_median_ns, result->latency_p99_ns);
+    } else {
+        char size_text[24];
+        if (size >= 1024 * 1024) snprintf(size_text, sizeof(size_text), "%zu MB", size / (1024 * 1024));
+        else if (size >= 1024) snprintf(size_text, sizeof(size_text), "%zu KB", size / 1024);
+        else snprintf(size_text, sizeof(size_text), "%zu B", size);
+
+        fprintf(out, "%-8s %-20s %-8s %8s %4u %12.2f %12.2f %8.3f %9.0f ns %9.0f ns\n",
+                cipher, api, backend, size_text, threads, result->mbps_median, result->mbps_min,
+                result->cpb_median, result->latency_median_ns, result->latency_p99_ns);
+    }
+    fflush(out);
+    options->rows++;
+
+    if (bench_row_count < BENCH_MAX_ROWS) {
+        bench_rows[bench_row_count++] = (bench_row_t){ cipher, api, backend, size, threads, *result };
+    }
+}
+
+// Buffers for the largest size of a row group, the key and the record nonces
+void bench_work_init(bench_work_t *work, size_t size) {
+    memset(work, 0, sizeof(*work));
+    for (int i = 0; i < 32; i++) work->key[i] = (uint8_t)i;
+    for (int r = 0; r < BENCH_RECORDS; r++) work->nonces[r][0] = (uint8_t)r;
+
+    helix2_initialize_context(&work->ctx, work->key, work->nonces[0]);
+    helix2_initialize_key(&work->schedule, work->key, work->nonces[0]);
+    for (int r = 0; r < BENCH_RECORDS; r++) {
+        uint8_t session_key[32];
+        for (int i = 0; i < 32; i++) session_key[i] = (uint8_t)(r * 32 + i);
+        helix2_initialize_key(&work->sessions[r], session_key, work->nonces[r]);
+    }
+    chacha20_initialize_key(&work->chacha, work->key, work->nonces[0]);
+
+    work->buffer = calloc(1, size);
+    work->dst = calloc(1, size);
+    if (!work->buffer || !work->dst) {
+        fprintf(stderr, "Error: Cannot allocate %zu byte benchmark buffers\n", size);
+        exit(1);
+    }
+}
+
+// One row, size is the message size reported and bytes_per_call what a call processes (more for batches)
+void bench_run(bench_options_t *options, const char *cipher, const char *api, const char *backend, bench_fn fn, bench_work_t *work, size_t size, size_t bytes_per_call, unsigned int threads) {
+    bench_result_t result;
+    work->offset = 0;
+    bench_measure(options, fn, work, bytes_per_call, &result);
+    bench_report(options, cipher, api, backend, size, threads, &result);
+}
+
+// The APIs under test, the keystream offset moves on with every call like a real stream
+void api_buffer(void *arg) {
+    bench_work_t *work = arg;
+    helix2_buffer(&work->ctx, work->buffer, work->size, work->offset);
+    work->offset += work->size;
+}
+
+void api_key_buffer(void *arg) {
+    bench_work_t *work = arg;
+    helix2_key_buffer(&work->schedule, work->buffer, work->size, work->offset);
+    work->offset += work->size;
+}
+
+// helix2_key_buffer through helix2_inline.h, short buffers never leave this file
+void api_key_buffer_inline(void *arg) {
+    bench_work_t *work = arg;
+    helix2_inline_key_buffer(&work->schedule, work->buffer, work->size, work->offset);
+    work->offset += work->size;
+}
+
+void api_key_buffer_copy(void *arg) {
+    bench_work_t *work = arg;
+    helix2_key_buffer_copy(&work->schedule, work->dst, work->buffer, work->size, work->offset);
+    work->offset += work->size;
+}
+
+void api_keystream(void *arg) {
+    bench_work_t *work = arg;
+    helix2_key_keystream(&work->schedule, work->dst, work->size, work->offset);
+    work->offset += work->size;
+}
+
+// BENCH_RECORDS small messages, each under its own nonce with a fresh context
+void api_records(void *arg) {
+    bench_work_t *work = arg;
+    for (int r = 0; r < BENCH_RECORDS; r++) {
+        helix2_initialize_context(&work->ctx, work->key, work->nonces[r]);
+        helix2_buffer(&work->ctx, work->messages[r].buffer, work->size, 0);
+    }
+}
+
+// The same messages in one batch call
+void api_batch(void *arg) {
+    bench_work_t *work = arg;
+    helix2_key_buffer_batch(&work->schedule, work->messages, BENCH_RECORDS);
+}
+
+// BENCH_RECORDS small messages under different keys, one call per session
+void api_sessions(void *arg) {
+    bench_work_t *work = arg;
+    for (int r = 0; r < BENCH_RECORDS; r++) {
+        helix2_key_buffer(&work->sessions[r], work->session_messages[r].buffer, work->size, 0);
+    }
+}
+
+// The same sessions in one multi-key call
+void api_multi(void *arg) {
+    bench_work_t *work = arg;
+    helix2_key_buffer_multi(work->session_messages, BENCH_RECORDS);
+}
+
+void api_parallel(void *arg) {
+    bench_work_t *work = arg;
+    helix2_key_buffer_parallel(&work->schedule, work->buffer, work->size, work->offset, &work->parallel);
+    work->offset += work->size;
+}
+
+// The ChaCha20 baseline through the same calls, bytes and offsets
+void api_chacha20_xor(void *arg) {
+    bench_work_t *work = arg;
+    chacha20_xor(&work->chacha, work->chacha_backend, work->buffer, work->buffer, work->size, work->offset);
+    work->offset += work->size;
+}
+
+void api_chacha20_copy(void *arg) {
+    bench_work_t *work = arg;
+    chacha20_xor(&work->chacha, work->chacha_backend, work->dst, work->buffer, work->size, work->offset);
+    work->offset += work->size;
+}
+
+void api_chacha20_keystream(void *arg) {
+    bench_work_t *work = arg;
+    chacha20_xor(&work->chacha, work->chacha_backend, work->dst, NULL, work->size, work->offset);
+    work->offset += work->size;
+}
+
+void api_chacha20_records(void *arg) {
+    bench_work_t *work = arg;
+    chacha20_key_t key;
+    for (int r = 0; r < BENCH_RECORDS; r++) {
+        chacha20_initialize_key(&key, work->key, work->nonces[r]);
+        chacha20_xor(&key, work->chacha_backend, work->messages[r].buffer, work->messages[r].buffer, work->size, 0);
+    }
+}
+
+static void bench_chunk(bench_chunk_t *chunk) {
+    bench_work_t *work = chunk->work;
+    chacha20_xor(&work->chacha, work->chacha_backend, &work->buffer[chunk->begin], &work->buffer[chunk->begin],
+                 chunk->end - chunk->begin, work->offset + chunk->begin);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI bench_chunk_thread(LPVOID arg) {
+    bench_chunk((bench_chunk_t *)arg);
+    return 0;
+}
+#else
+static void *bench_chunk_thread(void *arg) {
+    bench_chunk((bench_chunk_t *)arg);
+    return NULL;
+}
+#endif
+
+// Threads started per call and chunks on block boundaries, like the built-in threads of helix2_key_buffer_parallel
+void api_chacha20_parallel(void *arg) {
+    bench_work_t *work = arg;
+    bench_chunk_t chunks[BENCH_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE threads[BENCH_MAX_THREADS];
+#else
+    pthread_t threads[BENCH_MAX_THREADS];
+#endif
+    size_t share = (work->size / work->threads + CHACHA20_BLOCK_SIZE - 1) / CHACHA20_BLOCK_SIZE * CHACHA20_BLOCK_SIZE;
+
+    for (unsigned int t = 0; t < work->threads; t++) {
+        chunks[t].work = work;
+        chunks[t].begin = t * share < work->size ? t * share : work->size;
+        chunks[t].end = (t + 1) * share < work->size && t + 1 < work->threads ? (t + 1) * share : work->size;
+    }
+    for (unsigned int t = 1; t < work->threads; t++) {
+#ifdef _WIN32
+        threads[t] = CreateThread(NULL, 0, bench_chunk_thread, &chunks[t], 0, NULL);
+#else
+        pthread_create(&threads[t], NULL, bench_chunk_thread, &chunks[t]);
+#endif
+    }
+    bench_chunk(&chunks[0]);
+    for (unsigned int t = 1; t < work->threads; t++) {
+#ifdef _WIN32
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+#else
+        pthread_join(threads[t], NULL);
+#endif
+    }
+    work->offset += work->size;
+}
+
+void test_performance(bench_options_t *options) {
+    static const size_t sizes[] = {64, 256, 1024, 4096, 16384, 65536, 1024 * 1024};
+    static const size_t records[] = {64, 256};
+    static const struct { const char *name; bench_fn fn; bench_fn chacha20; } apis[] = {
+        { "buffer", api_buffer, NULL },
+        { "key_buffer", api_key_buffer, api_chacha20_xor },
+        { "key_buffer_copy", api_key_buffer_copy, api_chacha20_copy },
+        { "key_buffer_inline", api_key_buffer_inline, NULL },
+        { "keystream", api_keystream, api_chacha20_keystream },
+    };
+    bench_work_t *work = malloc(sizeof(bench_work_t));
+    if (!work) return;
+
+    bench_begin(options);
+
+    // Every supported backend through every API, then small records single against batched
+    // ChaCha20 follows with the same rows on the backend of the same name, where it has one
+    for (int b = HELIX2_BACKEND_SCALAR; b <= HELIX2_BACKEND_NEON; b++) {
+        if (!helix2_set_backend((helix2_backend_t)b)) continue;
+        const char *backend = helix2_backend_name((helix2_backend_t)b);
+
+        int chacha = -1;
+        for (int c = 0; c < CHACHA20_BACKENDS && options->chacha20; c++) {
+            if (chacha20_backend_supported((chacha20_backend_t)c) && strcmp(chacha20_backend_name((chacha20_backend_t)c), backend) == 0) chacha = c;
+        }
+        if (!options->helix2 && chacha < 0) continue;
+
+        bench_work_init(work, BENCH_MAX_SIZE);
+        work->chacha_backend = chacha < 0 ? CHACHA20_SCALAR : (chacha20_backend_t)chacha;
+        for (size_t a = 0; a < sizeof(apis) / sizeof(apis[0]); a++) {
+            for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+                work->size = sizes[s];
+                if (options->helix2) bench_run(options, "helix2", apis[a].name, backend, apis[a].fn, work, sizes[s], sizes[s], 1);
+                if (chacha >= 0 && apis[a].chacha20) bench_run(options, "chacha20", apis[a].name, backend, apis[a].chacha20, work, sizes[s], sizes[s], 1);
+            }
+        }
+
+        for (size_t s = 0; s < sizeof(records) / sizeof(records[0]); s++) {
+            work->size = records[s];
+            for (int r = 0; r < BENCH_RECORDS; r++) {
+                work->messages[r] = (helix2_message_t){ work->nonces[r], &work->buffer[r * records[s]], records[s], 0 };
+                work->session_messages[r] = (helix2_key_message_t){ &work->sessions[r], &work->buffer[r * records[s]], records[s], 0 };
+            }
+            if (options->helix2) {
+                bench_run(options, "helix2", "records_single", backend, api_records, work, records[s], records[s] * BENCH_RECORDS, 1);
+                bench_run(options, "helix2", "records_batch", backend, api_batch, work, records[s], records[s] * BENCH_RECORDS, 1);
+                bench_run(options, "helix2", "sessions_single", backend, api_sessions, work, records[s], records[s] * BENCH_RECORDS, 1);
+                bench_run(options, "helix2", "sessions_multi", backend, api_multi, work, records[s], records[s] * BENCH_RECORDS, 1);
+            }
+            if (chacha >= 0) bench_run(options, "chacha20", "records_single", backend, api_chacha20_records, work, records[s], records[s] * BENCH_RECORDS, 1);
         }
-        printf("\n");
+        free(work->buffer);
+        free(work->dst);
     }
-    
-    printf("\n");
+    helix2_set_backend(HELIX2_BACKEND_AUTO);
+
+    // Thread scaling, 1, 2, 4, ... up to max_threads, each cipher on its widest backend
+    bench_work_init(work, BENCH_PARALLEL_SIZE);
+    for (int c = 0; c < CHACHA20_BACKENDS; c++) {
+        if (chacha20_backend_supported((chacha20_backend_t)c)) work->chacha_backend = (chacha20_backend_t)c;
+    }
+    work->size = BENCH_PARALLEL_SIZE;
+    for (unsigned int threads = 1; ; threads = threads * 2 > options->max_threads && threads < options->max_threads ? options->max_threads : threads * 2) {
+        work->parallel = (helix2_parallel_t){ threads, NULL, NULL };
+        work->threads = threads;
+        if (options->helix2) {
+            bench_run(options, "helix2", "key_buffer_parallel", helix2_backend_name(helix2_get_backend()), api_parallel, work,
+                      BENCH_PARALLEL_SIZE, BENCH_PARALLEL_SIZE, threads);
+        }
+        if (options->chacha20) {
+            bench_run(options, "chacha20", "key_buffer_parallel", chacha20_backend_name(work->chacha_backend), api_chacha20_parallel, work,
+                      BENCH_PARALLEL_SIZE, BENCH_PARALLEL_SIZE, threads);
+        }
+        if (threads >= options->max_threads) break;
+    }
+    free(work->buffer);
+    free(work->dst);
+    free(work);
+
+    bench_end(options);
 }
 
+void syntax(void) {
+    printf("Usage: helix2_performance [options]\n");
+    printf("  --format <f>    text (default), json or csv\n");
+    printf("  --output <file> Write the results to <file> instead of stdout\n");
+    printf("  --trials <n>    Timed trials per row (default 15), the median and p99 are over these\n");
+    printf("  --trial-ms <n>  Length of one trial in ms (default 20), warmup is twice this\n");
+    printf("  --threads <n>   Largest thread count of the scaling rows (default one per CPU, at most 64)\n");
+    printf("  --cipher <c>    helix2, chacha20 or all (default), the comparison needs both\n");
+    printf("  --quick         5 trials of 2 ms, for smoke tests\n");
+}
 
 int main(int argc, char *argv[]) {
-    test_performance();
+    bench_options_t options = { 15, 40.0, 20.0, FORMAT_TEXT, bench_cpu_count(), 1, 1, stdout, 0 };
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--format") == 0 && value) {
+            options.format = strcmp(value, "json") == 0 ? FORMAT_JSON : strcmp(value, "csv") == 0 ? FORMAT_CSV : FORMAT_TEXT;
+            i++;
+        } else if (strcmp(argv[i], "--output") == 0 && value) {
+            options.out = fopen(value, "w");
+            if (!options.out) {
+                fprintf(stderr, "Error: Cannot open output file '%s'\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--trials") == 0 && value) {
+            options.trials = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--trial-ms") == 0 && value) {
+            options.trial_ms = atof(value);
+            options.warmup_ms = 2.0 * options.trial_ms;
+            i++;
+        } else if (strcmp(argv[i], "--threads") == 0 && value) {
+            options.max_threads = (unsigned int)atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--cipher") == 0 && value) {
+            options.helix2 = strcmp(value, "chacha20") != 0;
+            options.chacha20 = strcmp(value, "helix2") != 0;
+            i++;
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            options.trials = 5;
+            options.trial_ms = 2.0;
+            options.warmup_ms = 4.0;
+        } else {
+            syntax();
+            return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (options.trials < 1 || options.trials > BENCH_MAX_TRIALS || options.trial_ms <= 0.0 ||
+        options.max_threads < 1 || options.max_threads > BENCH_MAX_THREADS) {
+        syntax();
+        return 1;
+    }
+
+    // A baseline that computes the wrong thing would make every comparison meaningless
+    if (!chacha20_self_test()) {
+        fprintf(stderr, "Error: ChaCha20 baseline fails its RFC 8439 self test\n");
+        return 1;
+    }
+
+    test_performance(&options);
+
+    if (options.out != stdout) fclose(options.out);
     return 0;
-}
\ No newline at end of file
+}
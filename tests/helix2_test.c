@@ -34,11 +34,17 @@
  * SOFTWARE.
  */
 
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L     // fileno
+#endif
+
 #include "../src/helix2.h"
+#include "../src/helix2_inline.h"
 #include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <stdlib.h>
 
 uint8_t key[32] = {
     0x78, 0x56, 0x34, 0x12,  // 0x12345678 in little-endian bytes
@@ -59,6 +65,27 @@ void test_determinism(void);
 void test_offset_seek(void);    
 void test_entropy(void);
 void test_vectors(void);
+void test_bulk_equivalence(void);
+void test_bulk_counter_carry(void);
+void test_backends(void);
+void test_key_schedule(void);
+void test_parallel(void);
+void test_keystream(void);
+void test_buffer_copy(void);
+void test_iov(void);
+void test_stream(void);
+void test_batch(void);
+void test_set_nonce(void);
+void test_pread(void);
+void test_stats(void);
+void test_session(void);
+void test_pool(void);
+void test_prefetch(void);
+void test_cache(void);
+void test_multi(void);
+void test_async(void);
+void test_inline(void);
+void test_opencl(void);
 void run_all_tests(void);
 
 
@@ -275,6 +302,842 @@ void test_vectors(void) {
     assert(bytes[3] == 0xFE);        
 }
 
+void test_bulk_equivalence(void) {
+    helix2_context_t ctx;
+    uint8_t nonce[20] = { 0x5A, 0xA5, 0x5A, 0xA5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+    helix2_initialize_context(&ctx, key, nonce);
+
+    // Reference stream, one byte per call
+    static uint8_t reference[4096];
+    for (int i = 0; i < 4096; i++) {
+        reference[i] = (uint8_t)(i * 7);
+        helix2_buffer(&ctx, &reference[i], 1, (uint64_t)i);
+    }
+
+    // Bulk calls with unaligned pointers, partial leading and trailing blocks, multi-block batches
+    size_t starts[] = {0, 1, 7, 63, 64, 65, 200};
+    size_t sizes[] = {0, 1, 8, 63, 64, 65, 129, 500, 1024, 1087, 2048, 3000};
+    static uint8_t storage[4096 + 1];
+    for (int s = 0; s < 7; s++) {
+        for (int z = 0; z < 12; z++) {
+            uint8_t *bulk = &storage[1];
+            for (int i = 0; i < 4096; i++) bulk[i] = (uint8_t)(i * 7);
+
+            helix2_buffer(&ctx, &bulk[starts[s]], sizes[z], starts[s]);
+            for (size_t i = starts[s]; i < starts[s] + sizes[z]; i++) {
+                assert(bulk[i] == reference[i]);
+            }
+        }
+    }
+}
+
+void test_bulk_counter_carry(void) {
+    helix2_context_t ctx;
+    uint8_t nonce[20] = { 0x10, 0x20, 0x30, 0x40, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+    helix2_initialize_context(&ctx, key, nonce);
+
+    // 32 blocks around the 2^32 block boundary, one call versus one block per call
+    uint64_t start = (0xFFFFFFFFULL - 15) * HELIX2_KEYSTREAM_SIZE;
+    uint8_t bulk[32 * HELIX2_KEYSTREAM_SIZE] = {0};
+    uint8_t single[32 * HELIX2_KEYSTREAM_SIZE] = {0};
+
+    helix2_buffer(&ctx, bulk, sizeof(bulk), start);
+    assert(ctx.state[10] == 0x0000000F);
+    assert(ctx.state[11] == (_pack4(&nonce[0]) ^ 0x00000001));
+
+    for (int i = 0; i < 32; i++) {
+        helix2_buffer(&ctx, &single[i * HELIX2_KEYSTREAM_SIZE], HELIX2_KEYSTREAM_SIZE, start + (uint64_t)i * HELIX2_KEYSTREAM_SIZE);
+    }
+    assert(memcmp(bulk, single, sizeof(bulk)) == 0);
+    assert(memcmp(ctx.stream, &single[31 * HELIX2_KEYSTREAM_SIZE], HELIX2_KEYSTREAM_SIZE) == 0);
+}
+
+void test_backends(void) {
+    helix2_context_t ctx;
+    uint8_t nonce[20] = { 0x0B, 0xAC, 0xE0, 0x0D, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    static uint8_t reference[3000];
+    static uint8_t data[3000];
+
+    helix2_initialize_context(&ctx, key, nonce);
+    printf("Runtime selected backend: %s\n", helix2_backend_name(helix2_get_backend()));
+    assert(helix2_set_backend(HELIX2_BACKEND_SCALAR));
+    assert(helix2_get_backend() == HELIX2_BACKEND_SCALAR);
+
+    memset(reference, 0, sizeof(reference));
+    helix2_buffer(&ctx, reference, sizeof(reference), 5);
+
+    // Every backend the CPU supports must produce the scalar keystream
+    for (int b = HELIX2_BACKEND_SCALAR; b <= HELIX2_BACKEND_NEON; b++) {
+        bool supported = helix2_backend_supported((helix2_backend_t)b);
+        assert(helix2_set_backend((helix2_backend_t)b) == supported);
+        if (!supported) continue;
+
+        assert(helix2_get_backend() == (helix2_backend_t)b);
+        printf("Backend %-6s: ", helix2_backend_name((helix2_backend_t)b));
+        memset(data, 0, sizeof(data));
+        helix2_buffer(&ctx, data, sizeof(data), 5);
+        assert(memcmp(data, reference, sizeof(data)) == 0);
+        printf("OK\n");
+
+        test_bulk_equivalence();
+        test_bulk_counter_carry();
+        test_batch();
+    }
+
+    // Switching backends while worker threads encrypt, every call still gets the same keystream
+    enum { JOBS = 16 };
+    static uint8_t jobs[JOBS][3000];
+    helix2_key_t schedule;
+    helix2_initialize_key(&schedule, key, nonce);
+    helix2_async_t *async = helix2_async_create(2, JOBS, NULL);
+    assert(async != NULL);
+    memset(jobs, 0, sizeof(jobs));
+    for (int j = 0; j < JOBS; j++) helix2_async_submit(async, &schedule, jobs[j], jobs[j], sizeof(jobs[j]), 5);
+    for (int round = 0; round < 50; round++) {
+        for (int b = HELIX2_BACKEND_AUTO; b <= HELIX2_BACKEND_NEON; b++) helix2_set_backend((helix2_backend_t)b);
+    }
+    helix2_async_destroy(async);
+    for (int j = 0; j < JOBS; j++) assert(memcmp(jobs[j], reference, sizeof(reference)) == 0);
+
+    assert(helix2_set_backend(HELIX2_BACKEND_AUTO));
+    assert(helix2_get_backend() != HELIX2_BACKEND_AUTO);
+}
+
+void test_key_schedule(void) {
+    helix2_context_t ctx;
+    helix2_key_t schedule, schedule_copy;
+    uint8_t nonce[20] = { 0xC0, 0xFF, 0xEE, 0x00, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+    static uint8_t expected[2500];
+    static uint8_t data[2500];
+
+    helix2_initialize_context(&ctx, key, nonce);
+    helix2_initialize_key(&schedule, key, nonce);
+    memcpy(&schedule_copy, &schedule, sizeof(schedule));
+
+    // Same keystream as the context at any offset, without ever writing the schedule
+    uint64_t offsets[] = {0, 3, 64, 1000, 0xFFFFFFFFULL * HELIX2_KEYSTREAM_SIZE - 100};
+    size_t sizes[] = {0, 1, 64, 777, 2500};
+    for (int o = 0; o < 5; o++) {
+        for (int z = 0; z < 5; z++) {
+            for (size_t i = 0; i < sizes[z]; i++) expected[i] = data[i] = (uint8_t)i;
+
+            helix2_buffer(&ctx, expected, sizes[z], offsets[o]);
+            helix2_key_buffer(&schedule, data, sizes[z], offsets[o]);
+            assert(memcmp(expected, data, sizes[z]) == 0);
+        }
+    }
+    assert(memcmp(&schedule, &schedule_copy, sizeof(schedule)) == 0);
+}
+
+// Stand-in for a caller thread pool, runs the tasks in reverse order on the calling thread
+static void test_pool_parallel_for(void* pool, helix2_task_fn task, void* task_arg, size_t count) {
+    size_t *calls = (size_t *)pool;
+    for (size_t i = count; i > 0; i--) {
+        task(task_arg, i - 1);
+        (*calls)++;
+    }
+}
+
+void test_parallel(void) {
+    helix2_context_t ctx_serial, ctx_parallel;
+    helix2_key_t schedule;
+    uint8_t nonce[20] = { 0x9A, 0x11, 0xE1, 0x00, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+    size_t size = 3 * 1024 * 1024 + 77;
+
+    uint8_t *expected = malloc(size);
+    uint8_t *data = malloc(size);
+    assert(expected != NULL && data != NULL);
+
+    helix2_initialize_context(&ctx_serial, key, nonce);
+    helix2_initialize_context(&ctx_parallel, key, nonce);
+    helix2_initialize_key(&schedule, key, nonce);
+
+    // Built-in threads, from unaligned start offsets
+    uint64_t offsets[] = {0, 13, 64 * 1000 + 63};
+    unsigned int threads[] = {0, 1, 3, 8};
+    for (int o = 0; o < 3; o++) {
+        for (size_t i = 0; i < size; i++) expected[i] = (uint8_t)(i ^ (i >> 8));
+        helix2_buffer(&ctx_serial, expected, size, offsets[o]);
+
+        for (int t = 0; t < 4; t++) {
+            helix2_parallel_t parallel = { threads[t], NULL, NULL };
+            for (size_t i = 0; i < size; i++) data[i] = (uint8_t)(i ^ (i >> 8));
+
+            helix2_buffer_parallel(&ctx_parallel, data, size, offsets[o], &parallel);
+            assert(memcmp(expected, data, size) == 0);
+            assert(memcmp(ctx_serial.stream, ctx_parallel.stream, HELIX2_KEYSTREAM_SIZE) == 0);
+            assert(memcmp(ctx_serial.state, ctx_parallel.state, HELIX2_KEYSTREAM_SIZE) == 0);
+        }
+    }
+
+    // Caller supplied pool
+    size_t calls = 0;
+    helix2_parallel_t pool = { 0, test_pool_parallel_for, &calls };
+    for (size_t i = 0; i < size; i++) data[i] = (uint8_t)(i ^ (i >> 8));
+    helix2_key_buffer_parallel(&schedule, data, size, offsets[2], &pool);
+    assert(memcmp(expected, data, size) == 0);
+    assert(calls > 1);
+
+    // Default options
+    helix2_key_buffer_parallel(&schedule, data, size, offsets[2], NULL);
+    for (size_t i = 0; i < size; i++) assert(data[i] == (uint8_t)(i ^ (i >> 8)));
+
+    free(expected);
+    free(data);
+}
+
+void test_keystream(void) {
+    helix2_context_t ctx_buffer, ctx_keystream;
+    helix2_key_t schedule;
+    uint8_t nonce[20] = { 0x4B, 0x45, 0x59, 0x53, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2 };
+    size_t size = 9 * 1024 * 1024 + 5;       // above the non-temporal threshold
+
+    uint8_t *expected = calloc(size, 1);
+    uint8_t *storage = malloc(size + 1);
+    assert(expected != NULL && storage != NULL);
+
+    helix2_initialize_context(&ctx_buffer, key, nonce);
+    helix2_initialize_context(&ctx_keystream, key, nonce);
+    helix2_initialize_key(&schedule, key, nonce);
+
+    // Raw keystream equals helix2_buffer over zeros, for aligned and unaligned destinations
+    helix2_buffer(&ctx_buffer, expected, size, 21);
+    for (int misalign = 0; misalign < 2; misalign++) {
+        uint8_t *out = &storage[misalign];
+        size_t sizes[] = {0, 10, 64, 1000, 4096, size};
+        for (int z = 0; z < 6; z++) {
+            memset(out, 0xA5, sizes[z]);
+            helix2_keystream(&ctx_keystream, out, sizes[z], 21);
+            assert(memcmp(out, expected, sizes[z]) == 0);
+
+            memset(out, 0x5A, sizes[z]);
+            helix2_key_keystream(&schedule, out, sizes[z], 21);
+            assert(memcmp(out, expected, sizes[z]) == 0);
+        }
+    }
+    assert(memcmp(ctx_buffer.stream, ctx_keystream.stream, HELIX2_KEYSTREAM_SIZE) == 0);
+    assert(memcmp(ctx_buffer.state, ctx_keystream.state, HELIX2_KEYSTREAM_SIZE) == 0);
+
+    free(expected);
+    free(storage);
+}
+
+void test_buffer_copy(void) {
+    helix2_context_t ctx_inplace, ctx_copy;
+    helix2_key_t schedule;
+    uint8_t nonce[20] = { 0xC0, 0x97, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3 };
+    static uint8_t source[3000 + 1];
+    static uint8_t expected[3000];
+    static uint8_t storage[3000 + 1];
+
+    helix2_initialize_context(&ctx_inplace, key, nonce);
+    helix2_initialize_context(&ctx_copy, key, nonce);
+    helix2_initialize_key(&schedule, key, nonce);
+
+    for (int i = 0; i < 3001; i++) source[i] = (uint8_t)(i * 13);
+
+    // Unaligned source and destination, source left untouched
+    size_t sizes[] = {0, 1, 63, 64, 1025, 3000};
+    for (int z = 0; z < 6; z++) {
+        memcpy(expected, &source[1], sizes[z]);
+        helix2_buffer(&ctx_inplace, expected, sizes[z], 99);
+
+        memset(storage, 0, sizeof(storage));
+        helix2_buffer_copy(&ctx_copy, &storage[1], &source[1], sizes[z], 99);
+        assert(memcmp(&storage[1], expected, sizes[z]) == 0);
+        assert(memcmp(ctx_inplace.stream, ctx_copy.stream, HELIX2_KEYSTREAM_SIZE) == 0);
+        assert(memcmp(ctx_inplace.state, ctx_copy.state, HELIX2_KEYSTREAM_SIZE) == 0);
+
+        memset(storage, 0, sizeof(storage));
+        helix2_key_buffer_copy(&schedule, storage, &source[1], sizes[z], 99);
+        assert(memcmp(storage, expected, sizes[z]) == 0);
+    }
+    for (int i = 0; i < 3001; i++) assert(source[i] == (uint8_t)(i * 13));
+}
+
+void test_iov(void) {
+    helix2_context_t ctx_buffer, ctx_iov;
+    helix2_key_t schedule;
+    uint8_t nonce[20] = { 0x10, 0x7E, 0xC0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4 };
+    static uint8_t expected[4000];
+    static uint8_t data[4000];
+
+    helix2_initialize_context(&ctx_buffer, key, nonce);
+    helix2_initialize_context(&ctx_iov, key, nonce);
+    helix2_initialize_key(&schedule, key, nonce);
+
+    // Segments of varying sizes, including empty ones and a multi-block one
+    size_t lengths[] = {0, 1, 5, 63, 0, 64, 70, 1, 2000, 3, 128, 200, 0, 17};
+    helix2_iovec_t iov[14];
+    size_t total = 0;
+    for (int i = 0; i < 14; i++) {
+        iov[i].base = &data[total];
+        iov[i].length = lengths[i];
+        total += lengths[i];
+    }
+
+    for (size_t i = 0; i < total; i++) expected[i] = (uint8_t)(i * 3);
+    helix2_buffer(&ctx_buffer, expected, total, 1234);
+
+    for (size_t i = 0; i < total; i++) data[i] = (uint8_t)(i * 3);
+    helix2_buffer_iov(&ctx_iov, iov, 14, 1234);
+    assert(memcmp(expected, data, total) == 0);
+    assert(memcmp(ctx_buffer.stream, ctx_iov.stream, HELIX2_KEYSTREAM_SIZE) == 0);
+    assert(memcmp(ctx_buffer.state, ctx_iov.state, HELIX2_KEYSTREAM_SIZE) == 0);
+
+    for (size_t i = 0; i < total; i++) data[i] = (uint8_t)(i * 3);
+    helix2_key_buffer_iov(&schedule, iov, 14, 1234);
+    assert(memcmp(expected, data, total) == 0);
+}
+
+void test_stream(void) {
+    helix2_context_t ctx;
+    helix2_stream_t stream;
+    uint8_t nonce[20] = { 0x57, 0x52, 0x45, 0x41, 0x4D, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5 };
+    static uint8_t expected[5000];
+    static uint8_t data[5000];
+
+    helix2_initialize_context(&ctx, key, nonce);
+    helix2_stream_init(&stream, key, nonce, 7);
+
+    for (int i = 0; i < 5000; i++) expected[i] = data[i] = (uint8_t)(i * 11);
+    helix2_buffer(&ctx, expected, 5000, 7);
+
+    // Record-sized updates, then a multi-block one, then small ones again
+    size_t updates[] = {1, 2, 3, 56, 64, 100, 13, 0, 1, 2048, 5, 77, 63, 64, 65};
+    size_t done = 0;
+    for (int i = 0; i < 15; i++) {
+        helix2_stream_update(&stream, &data[done], updates[i]);
+        done += updates[i];
+        assert(stream.offset == 7 + done);
+    }
+    helix2_stream_update(&stream, &data[done], 5000 - done);
+    assert(memcmp(expected, data, 5000) == 0);
+
+    // Seek back into the middle of a block
+    for (int i = 900; i < 1000; i++) data[i] = expected[i];
+    helix2_stream_seek(&stream, 7 + 900);
+    helix2_stream_update(&stream, &data[900], 30);
+    helix2_stream_update(&stream, &data[930], 70);
+    for (int i = 900; i < 1000; i++) assert(data[i] == (uint8_t)(i * 11));
+}
+
+void test_batch(void) {
+    helix2_key_t schedule;
+    helix2_context_t ctx;
+    uint8_t nonces[40][20];
+    helix2_message_t messages[40];
+    static uint8_t expected[40][1500];
+    static uint8_t data[40][1500];
+
+    // Record-sized messages with block-aligned and unaligned offsets, empty ones, a counter carry and a long one
+    size_t sizes[] = {64, 100, 256, 1, 0, 63, 65, 128, 200, 1500};
+    uint64_t offsets[] = {0, 3, 64, 0xFFFFFFFFull * 64 + 30, 7, 0, 640, 1, 12345, 50};
+    for (int m = 0; m < 40; m++) {
+        for (int i = 0; i < 20; i++) nonces[m][i] = (uint8_t)(m * 7 + i);
+        size_t size = sizes[m % 10];
+        uint64_t offset = offsets[(m / 10 + m) % 10];
+
+        for (size_t i = 0; i < size; i++) expected[m][i] = data[m][i] = (uint8_t)(i + m);
+        helix2_initialize_context(&ctx, key, nonces[m]);
+        helix2_buffer(&ctx, expected[m], size, offset);
+
+        messages[m] = (helix2_message_t){ nonces[m], data[m], size, offset };
+    }
+
+    // The schedule's own nonce is not used by the batch
+    helix2_initialize_key(&schedule, key, nonces[39]);
+    helix2_key_buffer_batch(&schedule, messages, 40);
+    for (int m = 0; m < 40; m++) assert(memcmp(expected[m], data[m], messages[m].size) == 0);
+}
+
+void test_set_nonce(void) {
+    helix2_context_t fresh, rekeyed;
+    helix2_key_t schedule;
+    uint8_t nonce_a[20] = { 0xAA, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+    uint8_t nonce_b[20] = { 0xBB, 0x01, 0x02, 0x03, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19 };
+    uint8_t expected[300], data[300];
+
+    // Leave the high counter bits in the state before the nonce changes
+    helix2_initialize_context(&rekeyed, key, nonce_a);
+    memset(data, 0, sizeof(data));
+    helix2_buffer(&rekeyed, data, sizeof(data), 0x1234567890ull * 64);
+
+    helix2_initialize_context(&fresh, key, nonce_b);
+    helix2_set_nonce(&rekeyed, nonce_b);
+    assert(memcmp(fresh.state, rekeyed.state, sizeof(fresh.state)) == 0);
+    assert(memcmp(fresh.rows, rekeyed.rows, sizeof(fresh.rows)) == 0);
+    assert(fresh.nonce_word == rekeyed.nonce_word);
+
+    for (int i = 0; i < 300; i++) expected[i] = data[i] = (uint8_t)(i * 5);
+    helix2_buffer(&fresh, expected, sizeof(expected), 77);
+    helix2_buffer_nonce(&rekeyed, nonce_b, data, sizeof(data), 77);
+    assert(memcmp(expected, data, sizeof(data)) == 0);
+    assert(memcmp(fresh.state, rekeyed.state, sizeof(fresh.state)) == 0);
+
+    // Same for a key schedule
+    helix2_initialize_key(&schedule, key, nonce_a);
+    helix2_key_set_nonce(&schedule, nonce_b);
+    for (int i = 0; i < 300; i++) data[i] = (uint8_t)(i * 5);
+    helix2_key_buffer(&schedule, data, sizeof(data), 77);
+    assert(memcmp(expected, data, sizeof(data)) == 0);
+}
+
+void test_pread(void) {
+    helix2_key_t schedule;
+    uint8_t nonce[20] = { 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+    static uint8_t plain[10000], cipher[10000], range[10000];
+
+    for (int i = 0; i < 10000; i++) plain[i] = cipher[i] = (uint8_t)(i * 13 + 1);
+    helix2_initialize_key(&schedule, key, nonce);
+    helix2_key_buffer(&schedule, cipher, sizeof(cipher), 0);
+
+    FILE *file = tmpfile();
+    assert(file != NULL);
+    assert(fwrite(cipher, 1, sizeof(cipher), file) == sizeof(cipher));
+    assert(fflush(file) == 0);
+    int fd = fileno(file);
+
+    // Unaligned ranges inside one block, across blocks, the whole file and past its end
+    size_t offsets[] = {0, 5, 64, 63, 4000, 9990, 0, 10000};
+    size_t sizes[] = {1, 50, 128, 2, 4096, 100, 10000, 10};
+    for (int r = 0; r < 8; r++) {
+        size_t expected = offsets[r] + sizes[r] > 10000 ? 10000 - offsets[r] : sizes[r];
+        int64_t count = helix2_key_pread(&schedule, fd, range, sizes[r], offsets[r]);
+        assert(count == (int64_t)expected);
+        assert(memcmp(range, &plain[offsets[r]], expected) == 0);
+    }
+
+    fclose(file);
+}
+
+void test_stats(void) {
+    helix2_key_t schedule;
+    helix2_stream_t stream;
+    helix2_stats_t before, after;
+    uint8_t nonce[20] = {0};
+    static uint8_t data[4096];
+
+    // Without HELIX2_STATS nothing is counted
+    if (!helix2_get_stats(&before)) {
+        assert(before.calls == 0 && before.blocks == 0 && before.threads == 0);
+        assert(before.backend == helix2_get_backend());
+        return;
+    }
+
+    // Unaligned call inside two blocks, both partial, 28 keystream bytes unused
+    helix2_initialize_key(&schedule, key, nonce);
+    helix2_get_stats(&before);
+    helix2_key_buffer(&schedule, data, 100, 10);
+    helix2_get_stats(&after);
+    assert(after.calls - before.calls == 1);
+    assert(after.bytes - before.bytes == 100);
+    assert(after.blocks - before.blocks == 2);
+    assert(after.partial_blocks - before.partial_blocks == 2);
+    assert(after.discarded_bytes - before.discarded_bytes == 28);
+    assert(after.backend_blocks[HELIX2_BACKEND_SCALAR] - before.backend_blocks[HELIX2_BACKEND_SCALAR] == 2);
+    assert(after.size_histogram[6] - before.size_histogram[6] == 1);
+
+    // Aligned whole blocks, no waste
+    helix2_get_stats(&before);
+    helix2_key_buffer(&schedule, data, sizeof(data), 0);
+    helix2_get_stats(&after);
+    assert(after.blocks - before.blocks == sizeof(data) / HELIX2_KEYSTREAM_SIZE);
+    assert(after.partial_blocks == before.partial_blocks);
+    assert(after.discarded_bytes == before.discarded_bytes);
+    assert(after.size_histogram[12] - before.size_histogram[12] == 1);
+
+    // A stream update served from the kept keystream adds bytes but no block
+    helix2_stream_init(&stream, key, nonce, 0);
+    helix2_get_stats(&before);
+    helix2_stream_update(&stream, data, 10);
+    helix2_stream_update(&stream, data, 20);
+    helix2_get_stats(&after);
+    assert(after.bytes - before.bytes == 30);
+    assert(after.blocks - before.blocks == 1);
+    assert(after.calls - before.calls == 1);
+    assert(after.threads >= 1);
+}
+
+void test_session(void) {
+    helix2_key_t schedule, expanded;
+    helix2_session_t session;
+    uint8_t nonce[20] = { 3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9, 3, 2, 3, 8, 4 };
+    uint8_t other[20] = { 2, 7, 1, 8, 2, 8, 1, 8, 2, 8, 4, 5, 9, 0, 4, 5, 2, 3, 5, 3 };
+    static uint8_t expected[3000], actual[3000], copy[3000];
+
+    assert(sizeof(helix2_session_t) == HELIX2_CACHE_LINE);
+
+    helix2_initialize_key(&schedule, key, nonce);
+    helix2_session_init(&session, key, nonce);
+    helix2_session_key(&session, &expanded);
+    assert(memcmp(&expanded, &schedule, sizeof(schedule)) == 0);
+
+    // Unaligned start and length, in place and out of place
+    for (int i = 0; i < 3000; i++) expected[i] = actual[i] = (uint8_t)(i * 7);
+    helix2_key_buffer(&schedule, expected, sizeof(expected), 100);
+    helix2_session_buffer_copy(&session, copy, actual, sizeof(actual), 100);
+    helix2_session_buffer(&session, actual, sizeof(actual), 100);
+    assert(memcmp(actual, expected, sizeof(actual)) == 0);
+    assert(memcmp(copy, expected, sizeof(copy)) == 0);
+
+    // New nonce under the same key
+    helix2_key_set_nonce(&schedule, other);
+    helix2_session_set_nonce(&session, other);
+    helix2_key_keystream(&schedule, expected, 777, 5);
+    memset(actual, 0, 777);
+    helix2_session_buffer(&session, actual, 777, 5);
+    assert(memcmp(actual, expected, 777) == 0);
+}
+
+void test_pool(void) {
+    void *objects[100];
+
+    assert(helix2_pool_create(0, 16) == NULL);
+    assert(helix2_pool_create(sizeof(helix2_session_t), 0) == NULL);
+
+    // Odd object size and small chunks, so the pool has to grow several times
+    helix2_pool_t *pool = helix2_pool_create(100, 7);
+    assert(pool != NULL);
+
+    for (int i = 0; i < 100; i++) {
+        objects[i] = helix2_pool_alloc(pool);
+        assert(objects[i] != NULL);
+        assert((uintptr_t)objects[i] % HELIX2_CACHE_LINE == 0);
+        for (int b = 0; b < 100; b++) assert(((uint8_t *)objects[i])[b] == 0);
+        memset(objects[i], 0xA5, 100);
+    }
+    for (int i = 0; i < 100; i++) {
+        for (int j = i + 1; j < 100; j++) {
+            uintptr_t a = (uintptr_t)objects[i], b = (uintptr_t)objects[j];
+            assert(a + 128 <= b || b + 128 <= a);       // 100 bytes take two whole cache lines
+        }
+    }
+
+    // Freed objects come back wiped
+    helix2_pool_free(pool, objects[42]);
+    helix2_pool_free(pool, NULL);
+    void *again = helix2_pool_alloc(pool);
+    assert(again == objects[42]);
+    for (int b = 0; b < 100; b++) assert(((uint8_t *)again)[b] == 0);
+
+    // Sessions from a pool
+    helix2_pool_t *sessions = helix2_pool_create(sizeof(helix2_session_t), 1024);
+    helix2_session_t *session = (helix2_session_t *)helix2_pool_alloc(sessions);
+    helix2_session_t *next = (helix2_session_t *)helix2_pool_alloc(sessions);
+    assert(session + 1 == next);
+    helix2_session_init(session, key, (const uint8_t *)"twenty byte nonce!!");
+
+    helix2_pool_destroy(sessions);
+    helix2_pool_destroy(pool);
+    helix2_pool_destroy(NULL);
+}
+
+void test_prefetch(void) {
+    helix2_key_t schedule;
+    uint8_t nonce[20] = { 1, 1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144, 233, 1, 2, 3, 4, 5, 6, 7 };
+    static uint8_t expected[100000], data[100000];
+
+    helix2_initialize_key(&schedule, key, nonce);
+    for (int i = 0; i < 100000; i++) expected[i] = data[i] = (uint8_t)(i * 31 + 7);
+    helix2_key_buffer(&schedule, expected, sizeof(expected), 1000);
+
+    // Smallest ring (32 blocks), filled by hand: ring hits, wraps, partial fills and inline fallback
+    helix2_prefetch_t *prefetch = helix2_prefetch_create(key, nonce, 1000, 1);
+    assert(prefetch != NULL);
+    assert(helix2_prefetch_available(prefetch) == 0);
+    assert(helix2_prefetch_fill(prefetch, 0) == 32 * HELIX2_KEYSTREAM_SIZE);
+    assert(helix2_prefetch_fill(prefetch, 0) == 0);
+    assert(helix2_prefetch_available(prefetch) == 32 * HELIX2_KEYSTREAM_SIZE - 1000 % 64);
+
+    size_t done = 0, step = 1;
+    while (done < 50000) {
+        size_t size = step;
+        if (done + size > 50000) size = 50000 - done;
+        helix2_prefetch_update(prefetch, &data[done], size);
+        done += size;
+        step = step * 7 % 997 + 1;
+        helix2_prefetch_fill(prefetch, (done % 3) * 500);
+    }
+    assert(memcmp(data, expected, 50000) == 0);
+
+    // Seek back over blocks the producer skipped, then forward past the ring
+    for (int i = 0; i < 100000; i++) data[i] = (uint8_t)(i * 31 + 7);
+    helix2_prefetch_seek(prefetch, 1000 + 20000);
+    helix2_prefetch_fill(prefetch, 0);
+    helix2_prefetch_update(prefetch, &data[20000], 3000);
+    helix2_prefetch_seek(prefetch, 1000 + 90000);
+    helix2_prefetch_fill(prefetch, 0);
+    helix2_prefetch_update(prefetch, &data[90000], 10000);
+    assert(memcmp(&data[20000], &expected[20000], 3000) == 0);
+    assert(memcmp(&data[90000], &expected[90000], 10000) == 0);
+    helix2_prefetch_destroy(prefetch);
+
+    // Background producer racing the consumer
+    for (int i = 0; i < 100000; i++) data[i] = (uint8_t)(i * 31 + 7);
+    prefetch = helix2_prefetch_create(key, nonce, 1000, 4096);
+    assert(prefetch != NULL);
+    assert(helix2_prefetch_start(prefetch));
+    for (done = 0, step = 3; done < sizeof(data); done += step, step = step * 5 % 251 + 1) {
+        if (done + step > sizeof(data)) step = sizeof(data) - done;
+        helix2_prefetch_update(prefetch, &data[done], step);
+    }
+    helix2_prefetch_stop(prefetch);
+    assert(memcmp(data, expected, sizeof(data)) == 0);
+    helix2_prefetch_destroy(prefetch);
+    helix2_prefetch_destroy(NULL);
+}
+
+void test_cache(void) {
+    helix2_key_t schedule;
+    helix2_cache_stats_t stats;
+    uint8_t nonce[20] = { 0xC0, 0xFF, 0xEE };
+    static uint8_t expected[64 * 1024], data[64 * 1024];
+
+    helix2_initialize_key(&schedule, key, nonce);
+    for (int i = 0; i < (int)sizeof(data); i++) expected[i] = (uint8_t)(i * 11 + 3);
+    helix2_key_buffer(&schedule, expected, sizeof(expected), 0);
+
+    // Four pages, random ranges over sixteen: many hits, misses and evictions, always the same bytes
+    helix2_cache_t *cache = helix2_cache_create(&schedule, 4 * HELIX2_CACHE_PAGE);
+    assert(cache != NULL);
+    uint32_t random = 12345;
+    for (int r = 0; r < 2000; r++) {
+        random = random * 1103515245u + 12345u;
+        size_t offset = (random >> 8) % (sizeof(data) - 1);
+        size_t size = 1 + (random >> 3) % 6000;
+        if (r % 4 != 0) offset %= 2 * HELIX2_CACHE_PAGE;      // hot region
+        if (offset + size > sizeof(data)) size = sizeof(data) - offset;
+
+        for (size_t i = 0; i < size; i++) data[offset + i] = (uint8_t)((offset + i) * 11 + 3);
+        helix2_cache_buffer(cache, &data[offset], size, offset);
+        assert(memcmp(&data[offset], &expected[offset], size) == 0);
+    }
+
+    helix2_cache_get_stats(cache, &stats);
+    assert(stats.capacity == 4 * HELIX2_CACHE_PAGE);
+    assert(stats.cached_bytes == stats.capacity);
+    assert(stats.hits > stats.misses);
+    assert(stats.evictions == stats.misses - 4);
+
+    // Repeating a cached range is all hits, a range the size of the cache goes around it
+    helix2_cache_buffer(cache, data, 100, 0);
+    helix2_cache_get_stats(cache, &stats);
+    uint64_t misses = stats.misses;
+    helix2_cache_buffer(cache, data, 100, 0);
+    helix2_cache_buffer(cache, data, sizeof(data), 0);
+    helix2_cache_get_stats(cache, &stats);
+    assert(stats.misses == misses);
+    assert(stats.bypassed_bytes == sizeof(data));
+    helix2_cache_destroy(cache);
+    helix2_cache_destroy(NULL);
+}
+
+void test_multi(void) {
+    enum { SESSIONS = 12, MESSAGES = 45 };
+    helix2_key_t schedules[SESSIONS];
+    helix2_context_t contexts[SESSIONS], serial[SESSIONS];
+    helix2_key_message_t key_messages[MESSAGES];
+    helix2_context_message_t context_messages[MESSAGES];
+    static uint8_t expected[MESSAGES][1500], data[MESSAGES][1500], copy[MESSAGES][1500];
+
+    // Sessions with different keys and nonces, some messages reuse a session (also a long one after short ones)
+    size_t sizes[] = {64, 100, 1, 0, 63, 65, 200, 1500, 17};
+    uint64_t offsets[] = {0, 3, 64, 7, 0xFFFFFFFFull * 64 + 30, 640, 1, 50, 12345};
+    for (int s = 0; s < SESSIONS; s++) {
+        uint8_t session_key[32], nonce[20];
+        for (int i = 0; i < 32; i++) session_key[i] = (uint8_t)(s * 17 + i);
+        for (int i = 0; i < 20; i++) nonce[i] = (uint8_t)(s * 3 + i * 5);
+        helix2_initialize_key(&schedules[s], session_key, nonce);
+        helix2_initialize_context(&contexts[s], session_key, nonce);
+        helix2_initialize_context(&serial[s], session_key, nonce);
+    }
+    for (int m = 0; m < MESSAGES; m++) {
+        int s = (m * 5) % SESSIONS;
+        size_t size = sizes[m % 9];
+        uint64_t offset = offsets[(m / 9 + m) % 9];
+        for (size_t i = 0; i < size; i++) expected[m][i] = data[m][i] = copy[m][i] = (uint8_t)(m + i * 3);
+
+        helix2_buffer(&serial[s], expected[m], size, offset);
+        key_messages[m] = (helix2_key_message_t){ &schedules[s], data[m], size, offset };
+        context_messages[m] = (helix2_context_message_t){ &contexts[s], copy[m], size, offset };
+    }
+
+    helix2_key_buffer_multi(key_messages, MESSAGES);
+    helix2_buffer_multi(context_messages, MESSAGES);
+    for (int m = 0; m < MESSAGES; m++) {
+        assert(memcmp(data[m], expected[m], key_messages[m].size) == 0);
+        assert(memcmp(copy[m], expected[m], context_messages[m].size) == 0);
+    }
+
+    // The contexts end where helix2_buffer leaves them
+    for (int s = 0; s < SESSIONS; s++) {
+        assert(memcmp(contexts[s].state, serial[s].state, sizeof(serial[s].state)) == 0);
+        assert(memcmp(contexts[s].stream, serial[s].stream, sizeof(serial[s].stream)) == 0);
+    }
+}
+
+// Offload device that serves every other job and counts them (one worker), the rest falls back to the CPU
+typedef struct
+{
+    int calls;
+    int served;
+} test_device_t;
+
+static bool test_offload_process(void* device, const helix2_key_t* schedule, uint8_t* dst, const uint8_t* src, size_t size, uint64_t start_offset) {
+    test_device_t *test = (test_device_t *)device;
+    if (test->calls++ % 2 == 0) return false;
+    if (src == NULL) {
+        helix2_key_keystream(schedule, dst, size, start_offset);
+    } else {
+        helix2_key_buffer_copy(schedule, dst, src, size, start_offset);
+    }
+    test->served++;
+    return true;
+}
+
+void test_async(void) {
+    enum { JOBS = 24, SIZE = 5000 };
+    helix2_key_t schedule;
+    helix2_ticket_t tickets[JOBS];
+    static uint8_t expected[JOBS][SIZE], data[JOBS][SIZE], copy[JOBS][SIZE];
+    uint8_t nonce[20] = {9, 8, 7, 6, 5, 4, 3, 2, 1};
+    helix2_initialize_key(&schedule, key, nonce);
+
+    size_t sizes[] = {0, 1, 63, 64, 65, 1000, 4096, SIZE};
+    uint64_t offsets[] = {0, 7, 64, 0xFFFFFFFFull * 64 + 30};
+    for (unsigned int threads = 1; threads <= 3; threads++) {
+        test_device_t device = {0, 0};
+        helix2_offload_t offload = { test_offload_process, &device };
+        helix2_async_t *async = helix2_async_create(threads, 4, threads == 1 ? &offload : NULL);
+        assert(async != NULL);
+
+        // More jobs than the depth, in place, copying and raw keystream jobs
+        for (int j = 0; j < JOBS; j++) {
+            size_t size = sizes[j % 8];
+            uint64_t offset = offsets[(j / 8 + j) % 4];
+            for (size_t i = 0; i < size; i++) expected[j][i] = data[j][i] = (uint8_t)(j + i * 7);
+            if (j % 3 == 2) memset(expected[j], 0, size);
+            helix2_key_buffer(&schedule, expected[j], size, offset);
+
+            if (j % 3 == 0) tickets[j] = helix2_async_submit(async, &schedule, data[j], data[j], size, offset);
+            else if (j % 3 == 1) tickets[j] = helix2_async_submit(async, &schedule, copy[j], data[j], size, offset);
+            else tickets[j] = helix2_async_submit(async, &schedule, data[j], NULL, size, offset);
+            assert(tickets[j] != 0 && (j == 0 || tickets[j] > tickets[j - 1]));
+        }
+
+        // Completion in any order, jobs stay done after their slot was reused
+        helix2_async_wait(async, tickets[JOBS - 1]);
+        helix2_async_drain(async);
+        for (int j = JOBS - 1; j >= 0; j--) {
+            assert(helix2_async_poll(async, tickets[j]));
+            helix2_async_wait(async, tickets[j]);
+            assert(memcmp(j % 3 == 1 ? copy[j] : data[j], expected[j], sizes[j % 8]) == 0);
+        }
+        assert(helix2_async_poll(async, 0));
+
+        if (threads == 1) assert(device.calls == JOBS && device.served == JOBS / 2);
+        helix2_async_destroy(async);
+    }
+    helix2_async_destroy(NULL);
+}
+
+void test_inline(void) {
+    helix2_key_t schedule;
+    helix2_context_t ctx, inline_ctx;
+    uint8_t nonce[20] = {1, 1, 2, 3, 5, 8, 13, 21, 34, 55};
+    static uint8_t expected[600], data[600], copy[600], block[64];
+    helix2_initialize_key(&schedule, key, nonce);
+    helix2_initialize_context(&ctx, key, nonce);
+    helix2_initialize_context(&inline_ctx, key, nonce);
+
+    // Single blocks, also across the 32-bit counter boundary
+    uint64_t blocks[] = {0, 1, 77, 0xFFFFFFFFull, 0x100000000ull};
+    for (size_t b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+        helix2_key_keystream(&schedule, expected, 64, blocks[b] * 64);
+        helix2_inline_key_block(&schedule, blocks[b], block);
+        assert(memcmp(block, expected, 64) == 0);
+    }
+
+    // Short buffers inlined, longer ones forwarded, the contexts end in the same state
+    size_t sizes[] = {0, 1, 7, 63, 64, 65, 128, HELIX2_INLINE_MAX - 1, HELIX2_INLINE_MAX, 600};
+    uint64_t offsets[] = {0, 5, 64, 0xFFFFFFFFull * 64 + 60};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+            size_t size = sizes[s];
+            for (size_t i = 0; i < size; i++) expected[i] = data[i] = (uint8_t)(s * 31 + o + i);
+
+            helix2_key_buffer(&schedule, expected, size, offsets[o]);
+            helix2_inline_key_buffer_copy(&schedule, copy, data, size, offsets[o]);
+            assert(memcmp(copy, expected, size) == 0);
+            helix2_inline_key_buffer(&schedule, data, size, offsets[o]);
+            assert(memcmp(data, expected, size) == 0);
+
+            helix2_buffer(&ctx, expected, size, offsets[o]);
+            helix2_inline_buffer(&inline_ctx, data, size, offsets[o]);
+            assert(memcmp(data, expected, size) == 0);
+            assert(memcmp(ctx.state, inline_ctx.state, sizeof(ctx.state)) == 0);
+            assert(memcmp(ctx.stream, inline_ctx.stream, sizeof(ctx.stream)) == 0);
+        }
+    }
+}
+
+// Only with an OpenCL device (a make GPU=opencl library and a runtime with a GPU or CPU device), checked against
+//   helix2_key_keystream and helix2_key_buffer_copy. A 4 KB pinned buffer makes the larger jobs take several launches.
+void test_opencl(void) {
+    enum { SIZE = 3 * 4096 + 100 };
+    helix2_key_t schedule;
+    static uint8_t expected[SIZE], data[SIZE], copy[SIZE];
+    uint8_t nonce[20] = {2, 7, 1, 8, 2, 8, 1, 8, 2, 8};
+    helix2_initialize_key(&schedule, key, nonce);
+
+    helix2_opencl_t *device = helix2_opencl_create(4096);
+    helix2_offload_t offload = helix2_opencl_offload(device);
+    assert((offload.process != NULL) == (device != NULL) && offload.device == device);
+    if (device == NULL) {
+        assert(!helix2_opencl_process(NULL, &schedule, data, NULL, 64, 0));
+        helix2_opencl_destroy(NULL);
+        return;
+    }
+
+    size_t sizes[] = {1, 63, 64, 65, 1000, 4096, 4097, 2 * 4096 + 1, SIZE};
+    uint64_t offsets[] = {0, 5, 64, 4000, 0xFFFFFFFFull * 64 + 30};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+            size_t size = sizes[s];
+            helix2_key_keystream(&schedule, expected, size, offsets[o]);
+            memset(data, 0xA5, size);
+            assert(helix2_opencl_process(device, &schedule, data, NULL, size, offsets[o]));
+            assert(memcmp(data, expected, size) == 0);
+
+            for (size_t i = 0; i < size; i++) data[i] = (uint8_t)(s * 13 + o + i);
+            helix2_key_buffer_copy(&schedule, expected, data, size, offsets[o]);
+            assert(helix2_opencl_process(device, &schedule, copy, data, size, offsets[o]));
+            assert(memcmp(copy, expected, size) == 0);
+            assert(helix2_opencl_process(device, &schedule, data, data, size, offsets[o]));
+            assert(memcmp(data, expected, size) == 0);
+        }
+    }
+
+    // Through the asynchronous queue, two workers sharing the device
+    helix2_async_t *async = helix2_async_create(2, 4, &offload);
+    assert(async != NULL);
+    for (size_t i = 0; i < SIZE; i++) expected[i] = data[i] = (uint8_t)(i * 5);
+    helix2_key_buffer(&schedule, expected, SIZE, 100);
+    helix2_ticket_t in_place = helix2_async_submit(async, &schedule, data, data, SIZE, 100);
+    helix2_ticket_t raw = helix2_async_submit(async, &schedule, copy, NULL, SIZE, 100);
+    helix2_async_drain(async);
+    assert(helix2_async_poll(async, in_place) && helix2_async_poll(async, raw));
+    assert(memcmp(data, expected, SIZE) == 0);
+    helix2_key_keystream(&schedule, expected, SIZE, 100);
+    assert(memcmp(copy, expected, SIZE) == 0);
+
+    helix2_async_destroy(async);
+    helix2_opencl_destroy(device);
+}
+
 void test_64bit_counter(void) {
     printf("\n=== Testing 64-bit Block Counter ===\n");
     
@@ -359,6 +1222,27 @@ void run_all_tests(void) {
     test_determinism();
     test_offset_seek();
     test_entropy();
+    test_bulk_equivalence();
+    test_bulk_counter_carry();
+    test_backends();
+    test_key_schedule();
+    test_parallel();
+    test_keystream();
+    test_buffer_copy();
+    test_iov();
+    test_stream();
+    test_batch();
+    test_set_nonce();
+    test_pread();
+    test_stats();
+    test_session();
+    test_pool();
+    test_prefetch();
+    test_cache();
+    test_multi();
+    test_async();
+    test_inline();
+    test_opencl();
     test_64bit_counter();
     test_vectors();
     printf("All tests passed successfully.\n");
@@ -34,10 +34,11 @@
  * SOFTWARE.
  */
 
-/* Enable large file support on Linux/POSIX systems */
+/* Enable large file support on Linux/POSIX systems (and O_DIRECT on Linux) */
 #ifndef _WIN32
     #define _POSIX_C_SOURCE 200112L
     #define _FILE_OFFSET_BITS 64
+    #define _GNU_SOURCE
 #endif
 
 #include "../src/helix2.h"
@@ -47,31 +48,247 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <inttypes.h>
+#include <errno.h>
 
-#define BUFFER_SIZE 1024
+#ifdef _WIN32
+    #include <windows.h>
+    #include <io.h>
+    #include <fcntl.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <pthread.h>
+    #include <dirent.h>
+    #include <time.h>
+    #include <signal.h>
+#endif
+
+#define BUFFER_SIZE (4 * 1024 * 1024)      /* default I/O buffer size, -b changes it */
+#define BUFFER_ALIGN 4096                   /* buffers and their sizes are page aligned, as direct I/O requires */
+#define BUFFER_MAX (1024 * 1024 * 1024)
+#define MMAP_CHUNK (16 * 1024 * 1024)       /* mapped files are processed (and the progress updated) in 16 MB steps */
+#define PIPELINE_SLOTS 3                    /* one being read, one being encrypted, one being written */
+#define PIPE_SIZE (1024 * 1024)             /* pipes are grown to this (Linux default maximum) for fewer wakeups */
 #define PROGRESS_WIDTH 10
+#define SWEEP_MAX (1024 * 1024)             /* -k --sweep streams, one key schedule each */
+
+#ifdef _WIN32
+    #define PATH_SEPARATOR '\\'
+#else
+    #define PATH_SEPARATOR '/'
+#endif
+
+/* Minimal thread, lock and condition wrappers for the I/O pipeline */
+#ifdef _WIN32
+    typedef HANDLE thread_t;
+    typedef CRITICAL_SECTION lock_t;
+    typedef CONDITION_VARIABLE cond_t;
+    #define THREAD_RETURN DWORD WINAPI
+    typedef LPTHREAD_START_ROUTINE thread_fn;
+    #define lock_init(l)    InitializeCriticalSection(l)
+    #define lock_destroy(l) DeleteCriticalSection(l)
+    #define lock_acquire(l) EnterCriticalSection(l)
+    #define lock_release(l) LeaveCriticalSection(l)
+    #define cond_init(c)    InitializeConditionVariable(c)
+    #define cond_destroy(c) ((void)(c))
+    #define cond_wait(c, l) SleepConditionVariableCS((c), (l), INFINITE)
+    #define cond_notify(c)  WakeAllConditionVariable(c)
+#else
+    typedef pthread_t thread_t;
+    typedef pthread_mutex_t lock_t;
+    typedef pthread_cond_t cond_t;
+    #define THREAD_RETURN void *
+    typedef void *(*thread_fn)(void *);
+    #define lock_init(l)    pthread_mutex_init((l), NULL)
+    #define lock_destroy(l) pthread_mutex_destroy(l)
+    #define lock_acquire(l) pthread_mutex_lock(l)
+    #define lock_release(l) pthread_mutex_unlock(l)
+    #define cond_init(c)    pthread_cond_init((c), NULL)
+    #define cond_destroy(c) pthread_cond_destroy(c)
+    #define cond_wait(c, l) pthread_cond_wait((c), (l))
+    #define cond_notify(c)  pthread_cond_broadcast(c)
+#endif
+
+/* Unbuffered file for the pipeline, optionally bypassing the page cache (O_DIRECT / FILE_FLAG_NO_BUFFERING) */
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    int fd;
+#endif
+    int direct;
+} raw_file_t;
+
+/* How raw_open opens a file, an update (in place) file is read and written with positioned I/O */
+enum { RAW_INPUT, RAW_OUTPUT, RAW_UPDATE };
+
+/* One file of a batch, relative is its name within the batch: the input argument's own name (a directory's or a file's
+   name) and the path below it, unique across all inputs as it picks the file's nonce and output path */
+typedef struct {
+    char *path;
+    char *relative;
+} batch_file_t;
+
+/* Files of a batch and the shared worker state, each worker takes the next unclaimed file */
+typedef struct {
+    batch_file_t *files;
+    size_t count;
+    size_t capacity;
+    size_t next;
+    size_t done;
+    size_t failed;
+    uint64_t bytes;
+    const helix2_key_t *schedule;
+    const uint8_t *nonce;
+    const char *output_dir;
+    lock_t lock;
+} batch_t;
+
+/* One buffer of the I/O pipeline, it cycles free -> read -> encrypted -> free */
+enum { SLOT_FREE, SLOT_READ, SLOT_DONE };
+
+typedef struct {
+    uint8_t *data;
+    size_t length;
+    uint64_t offset;
+    int state;
+} pipeline_slot_t;
+
+/* Reader thread -> cipher (calling thread) -> writer thread, chunk i always uses slot i % PIPELINE_SLOTS */
+typedef struct {
+    raw_file_t fin;
+    raw_file_t fout;            /* the same file as fin in place, both then use positioned reads and writes */
+    int in_place;
+    size_t buffer_size;
+    pipeline_slot_t slots[PIPELINE_SLOTS];
+    uint64_t chunks;            /* chunks read so far */
+    int eof;                    /* reader is done, chunks is final */
+    int error;                  /* a read or write failed, every stage stops */
+    lock_t lock;
+    cond_t changed;
+} pipeline_t;
+
+/* Raw keystream output (-k), chunk i is generated by worker i % workers into slot i % (2 * workers) and written in order
+   With --sweep, chunk i belongs to stream i % streams at keystream offset start + i / streams * buffer_size. */
+typedef struct {
+    raw_file_t fout;
+    const helix2_key_t *schedules;  /* one per stream */
+    uint64_t streams;
+    uint64_t start;
+    uint64_t length;                /* total output, UINT64_MAX until the output is closed */
+    uint64_t chunks;
+    size_t buffer_size;
+    pipeline_slot_t *slots;
+    unsigned int workers;           /* workers that started, set before any of them runs */
+    int error;                      /* the output failed or was closed, the workers stop */
+    lock_t lock;
+    cond_t changed;
+} keystream_t;
+
+typedef struct {
+    keystream_t *keystream;
+    unsigned int index;
+} keystream_worker_t;
+
+/* A whole file mapped into memory */
+typedef struct {
+    uint8_t *data;
+    uint64_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+} mapped_file_t;
 
 void syntax(); 
 void derive_key_from_password(const char *password, uint8_t *key);
 void generate_nonce_from_seed(uint32_t seed, uint32_t* nonce_out);
 void print_progress(uint64_t current, uint64_t total);
+void draw_progress(uint64_t current, uint64_t total);
+int is_regular_file(const char *filename);
+int map_file(mapped_file_t *map, const char *filename, int writable, int create, uint64_t create_size);
+void unmap_file(mapped_file_t *map);
+int run_command(int argc, char *argv[], const char **inputs);
+int process_buffered(helix2_stream_t *stream, const char *input_file, const char *output_file, size_t buffer_size, uint64_t *processed);
+int process_mmap(const helix2_key_t *schedule, const char *input_file, const char *output_file, uint64_t *processed);
+int process_pipeline(const helix2_key_t *schedule, const char *input_file, const char *output_file, unsigned int threads, size_t buffer_size, int direct, uint64_t *processed);
+int process_range(const helix2_key_t *schedule, const char *input_file, const char *output_file, uint64_t offset, uint64_t length, size_t buffer_size, uint64_t *processed);
+int process_keystream(const uint8_t *key, const uint8_t *nonce, uint64_t streams, int sweep_key, const char *output_file, uint64_t start, uint64_t length, unsigned int threads, size_t buffer_size, uint64_t *processed);
+void add_counter(uint8_t *bytes, size_t size, uint64_t value);
+int open_files(const char *input_file, const char *output_file, FILE **fin, FILE **fout, uint64_t *file_size);
+int seek_file(FILE *file, int64_t offset);
+int same_file(const char *a, const char *b);
+int parse_count(const char *s, uint64_t *count);
+size_t parse_size(const char *s);
+void *buffer_alloc(size_t size);
+void buffer_free(void *buffer);
+int raw_open(raw_file_t *file, const char *filename, int mode, int direct);
+int64_t raw_read(raw_file_t *file, uint8_t *buffer, size_t size, int64_t offset);
+int raw_write(raw_file_t *file, const uint8_t *buffer, size_t size, int64_t offset);
+int raw_close(raw_file_t *file, int output, uint64_t final_size);
+uint64_t raw_size(raw_file_t *file);
+#ifdef _WIN32
+void raw_position(OVERLAPPED *at, int64_t offset, size_t done);
+#else
+int raw_wait(raw_file_t *file, short events);
+#endif
+int process_batch(const helix2_key_t *schedule, const uint8_t *nonce, const char **inputs, size_t input_count, const char *output_dir, unsigned int threads);
+int batch_add(batch_t *batch, const char *path, const char *relative);
+int batch_scan(batch_t *batch, const char *directory, const char *relative);
+THREAD_RETURN batch_worker(void *arg);
+int batch_compare(const void *a, const void *b);
+void derive_file_nonce(const uint8_t *base, const char *relative, uint8_t *nonce);
+char *join_path(const char *dir, const char *name);
+char *path_name(const char *path);
+int make_parent_dirs(const char *path);
+int is_directory(const char *path);
+double seconds_now(void);
+unsigned int cpu_count(void);
+int thread_start(thread_t *thread, thread_fn fn, void *arg);
+void thread_join(thread_t thread);
+THREAD_RETURN pipeline_reader(void *arg);
+THREAD_RETURN pipeline_writer(void *arg);
+THREAD_RETURN keystream_worker(void *arg);
+
+static int show_progress = 1;  /* batch mode reports per file count instead of per byte */
+static FILE *console;          /* messages and progress, stderr when the output goes to stdout */
 
 void print_progress(uint64_t current, uint64_t total) {
+    if (show_progress) draw_progress(current, total);
+}
+
+void draw_progress(uint64_t current, uint64_t total) {
     static unsigned int last_percent = 101;  /* track last displayed filled count */
+    static uint64_t last_mb = UINT64_MAX;
     
-    if (total == 0) return;
+    /* Unknown size (a pipe), count the bytes instead */
+    if (total == 0) {
+        uint64_t mb = current / (1024 * 1024);
+        if (mb != last_mb) {
+            fprintf(console, "\r%" PRIu64 " MB", mb);
+            fflush(console);
+            last_mb = mb;
+        }
+        return;
+    }
     
     unsigned int percent = (unsigned int)(((double)current / (double)total) * 100.0);
     unsigned int filled = (unsigned int)(((double)current / (double)total) * (double)PROGRESS_WIDTH);
 
     /* Only print if the bar changed */
     if (percent != last_percent) {
-        printf("\r[");
+        fprintf(console, "\r[");
         for (int i = 0; i < PROGRESS_WIDTH; i++) {
-            putchar(i < filled ? 'X' : '_');
+            fputc(i < filled ? 'X' : '_', console);
         }
-        printf("] %u%%", percent);
-        fflush(stdout);
+        fprintf(console, "] %u%%", percent);
+        fflush(console);
         last_percent = percent;
     }
 }
@@ -138,11 +355,39 @@ void generate_nonce_from_seed(uint32_t seed, uint32_t* nonce_out) {
 
 
 int main(int argc, char *argv[]) {
+    console = stdout;
+
+    /* Room for every argument as an input, freed here so no exit of run_command leaks it */
+    const char **inputs = calloc((size_t)argc, sizeof(char *));
+    if (!inputs) {
+        fprintf(console, "Error: Cannot allocate the input list\n");
+        return 1;
+    }
+    int result = run_command(argc, argv, inputs);
+    free(inputs);
+    return result;
+}
+
+/* Parse the command line and run the selected mode, inputs has room for every argument */
+int run_command(int argc, char *argv[], const char **inputs) {
     const char *password = NULL;
     const char *input_file = NULL;
+    size_t input_count = 0;
     const char *output_file = NULL;
     uint8_t nonce[20] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-    int mode = 0;  /* 0=none, 1=encrypt, 2=decrypt */
+    int mode = 0;  /* 0=none, 1=encrypt, 2=decrypt, 3=keystream */
+    int use_mmap = 0;
+    int use_pipeline = 0;
+    int use_direct = 0;
+    int threads_given = 0;
+    int use_range = 0;
+    uint64_t range_offset = 0;
+    uint64_t range_length = UINT64_MAX;     /* to the end of the file */
+    unsigned int threads = 1;
+    size_t buffer_size = BUFFER_SIZE;
+    uint64_t sweep = 1;
+    const char *batch_name = NULL;
+    int sweep_key = 0;
 
     /* Parse command line arguments */
     for (int i = 1; i < argc; i++) {
@@ -150,11 +395,13 @@ int main(int argc, char *argv[]) {
             mode = 1;
         } else if (strcmp(argv[i], "-d") == 0) {
             mode = 2;
+        } else if (strcmp(argv[i], "-k") == 0) {
+            mode = 3;
         } else if (strcmp(argv[i], "-p") == 0) {
             if (i + 1 < argc) {
                 password = argv[++i];
             } else {
-                printf("Error: -p requires a password argument\n");
+                fprintf(console, "Error: -p requires a password argument\n");
                 return 1;
             }
         } else if (strcmp(argv[i], "-n") == 0) {
@@ -176,107 +423,1421 @@ int main(int argc, char *argv[]) {
                     nonce[i] = (uint8_t)strtoul(hex_byte, NULL, 16);
                 }
             } else {
-                printf("Error: -n requires hex string argument\n");
+                fprintf(console, "Error: -n requires hex string argument\n");
                 return 1;
             }
         } else if (strcmp(argv[i], "-o") == 0) {
             if (i + 1 < argc) {
                 output_file = argv[++i];
             } else {
-                printf("Error: -o requires an output filename\n");
+                fprintf(console, "Error: -o requires an output filename\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-m") == 0) {
+            use_mmap = 1;
+        } else if (strcmp(argv[i], "-t") == 0) {
+            if (i + 1 < argc) {
+                threads = (unsigned int)strtoul(argv[++i], NULL, 10);
+                threads_given = 1;
+                use_pipeline = 1;
+            } else {
+                fprintf(console, "Error: -t requires a thread count argument\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-b") == 0) {
+            if (i + 1 < argc) {
+                buffer_size = parse_size(argv[++i]);
+                if (buffer_size == 0) {
+                    fprintf(console, "Error: -b requires a size between 4K and 1G, ex. 256K, 8M\n");
+                    return 1;
+                }
+            } else {
+                fprintf(console, "Error: -b requires a size argument\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-D") == 0) {
+            use_direct = 1;
+            use_pipeline = 1;
+        } else if (strcmp(argv[i], "--offset") == 0 || strcmp(argv[i], "--length") == 0) {
+            int offset = argv[i][2] == 'o';
+            if (i + 1 < argc && parse_count(argv[i + 1], offset ? &range_offset : &range_length) == 0) {
+                use_range = 1;
+                i++;
+            } else {
+                fprintf(console, "Error: %s requires a byte count, ex. 4096, 64K, 10G\n", argv[i]);
                 return 1;
             }
+        } else if (strcmp(argv[i], "--sweep") == 0) {
+            if (i + 1 < argc && parse_count(argv[i + 1], &sweep) == 0 && sweep >= 1 && sweep <= SWEEP_MAX) {
+                i++;
+            } else {
+                fprintf(console, "Error: --sweep requires a stream count between 1 and %d\n", SWEEP_MAX);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--name") == 0) {
+            if (i + 1 < argc) {
+                batch_name = argv[++i];
+            } else {
+                fprintf(console, "Error: --name requires the file's name in its batch, ex. dataset/notes.txt\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sweep-key") == 0) {
+            sweep_key = 1;
         } else if (strcmp(argv[i], "-h") == 0) {
             syntax();
             return 0;
-        } else if (argv[i][0] != '-') {
-            /* Assume it's the input filename if it doesn't start with - */
+        } else if (argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+            /* Assume it's the input filename if it doesn't start with - (a lone - is stdin) */
             input_file = argv[i];
+            inputs[input_count++] = argv[i];
         } else {
-            printf("Error: Unknown option '%s'\n", argv[i]);
+            fprintf(console, "Error: Unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    /* Raw keystream, no input: the output of encrypting zeros, generated as fast as the output takes it */
+    if (mode == 3) {
+        if (input_file) {
+            fprintf(console, "Error: -k takes no input file\n");
+            return 1;
+        }
+        if (!password) {
+            fprintf(console, "Error: Missing required arguments\n");
+            syntax();
             return 1;
         }
+        if (!output_file) output_file = "-";
+        if (strcmp(output_file, "-") == 0) console = stderr;
+        if (!threads_given) threads = 0;
+        if (threads == 0) threads = cpu_count();
+
+        fprintf(console, "Mode: Keystream\n");
+        fprintf(console, "Output: %s, ", strcmp(output_file, "-") == 0 ? "stdout" : output_file);
+        if (range_length == UINT64_MAX) fprintf(console, "until closed\n");
+        else fprintf(console, "%" PRIu64 " bytes\n", range_length);
+        fprintf(console, "Threads: %u, buffer: %zu KB\n", threads, buffer_size / 1024);
+        fprintf(console, "Password: ********\n");
+        fprintf(console, "Nonce: 0x");
+        for (int i = 0; i < 20; i++) fprintf(console, "%02x", nonce[i]);
+        if (sweep > 1) fprintf(console, " (%s + 0..%" PRIu64 ", interleaved per buffer)", sweep_key ? "key" : "nonce", sweep - 1);
+        fprintf(console, "\n");
+
+        uint8_t key[32];
+        derive_key_from_password(password, key);
+
+        uint64_t processed = 0;
+        double start = seconds_now();
+        int result = process_keystream(key, nonce, sweep, sweep_key, output_file, range_offset, range_length, threads, buffer_size, &processed);
+        double seconds = seconds_now() - start;
+        if (result != 0) return result;
+
+        fprintf(console, "\n\nDone, wrote %" PRIu64 " bytes", processed);
+        if (seconds > 0) fprintf(console, " (%.1f MB/s)", (double)processed / seconds / (1024.0 * 1024.0));
+        fprintf(console, "\n");
+        return 0;
     }
 
     /* Validate inputs */
     if (!input_file || !password || mode == 0) {
-        printf("Error: Missing required arguments\n");
+        fprintf(console, "Error: Missing required arguments\n");
         syntax();
         return 1;
     }
 
-    printf("Mode: %s\n", mode == 1 ? "Encrypt" : "Decrypt");
-    printf("Input: %s\n", input_file);
-    printf("Output: %s\n", output_file ? output_file : input_file);
-    printf("Password: ********\n");
-    printf("Nonce: 0x");
+    /* stdin (and a range) has nowhere to be written back to, it goes to stdout unless -o says otherwise */
+    if (!output_file && (use_range || strcmp(input_file, "-") == 0)) output_file = "-";
+    int use_std = output_file && strcmp(output_file, "-") == 0;
+    for (size_t i = 0; i < input_count; i++) {
+        if (strcmp(inputs[i], "-") == 0) use_std = 1;
+    }
+    if (output_file && strcmp(output_file, "-") == 0) console = stderr;
+
+    /* Several inputs or a directory, every file gets its own nonce */
+    int batch = input_count > 1 || is_directory(input_file);
+    if (batch && use_std) {
+        fprintf(console, "Error: - (stdin/stdout) cannot be used in batch mode\n");
+        return 1;
+    }
+
+    if (batch && batch_name) {
+        fprintf(console, "Error: --name is for a single file, batch mode names every file itself\n");
+        return 1;
+    }
+
+    /* One file out of a batch, under the nonce batch mode gave it */
+    if (batch_name) derive_file_nonce(nonce, batch_name, nonce);
+
+    fprintf(console, "Mode: %s\n", mode == 1 ? "Encrypt" : "Decrypt");
+    if (batch) {
+        fprintf(console, "Inputs: %zu argument(s), batch mode\n", input_count);
+        fprintf(console, "Output: %s\n", output_file ? output_file : "in place");
+        fprintf(console, "Password: ********\n");
+        fprintf(console, "Nonce: 0x");
+        for (int i = 0; i < 20; i++) fprintf(console, "%02x", nonce[i]);
+        fprintf(console, " (mixed with each file's relative path)\n");
+
+        uint8_t key[32];
+        derive_key_from_password(password, key);
+
+        helix2_key_t schedule;
+        helix2_initialize_key(&schedule, key, nonce);
+
+        return process_batch(&schedule, nonce, inputs, input_count, output_file, threads_given ? threads : 0);
+    }
+
+    /* A range only reads the blocks it needs from the input, it has to be a file */
+    if (use_range) {
+        if (strcmp(input_file, "-") == 0) {
+            fprintf(console, "Error: --offset/--length need an input file, not stdin\n");
+            return 1;
+        }
+        if (range_length == UINT64_MAX) fprintf(console, "Input: %s, from offset %" PRIu64 " to the end\n", input_file, range_offset);
+        else fprintf(console, "Input: %s, %" PRIu64 " bytes at offset %" PRIu64 "\n", input_file, range_length, range_offset);
+        fprintf(console, "Output: %s\n", strcmp(output_file, "-") == 0 ? "stdout" : output_file);
+        fprintf(console, "Password: ********\n");
+
+        uint8_t key[32];
+        derive_key_from_password(password, key);
+
+        helix2_key_t schedule;
+        helix2_initialize_key(&schedule, key, nonce);
+
+        uint64_t processed = 0;
+        int result = process_range(&schedule, input_file, output_file, range_offset, range_length, buffer_size, &processed);
+        if (result != 0) return result;
+
+        fprintf(console, "\n\nDone, processed %" PRIu64 " bytes\n", processed);
+        return 0;
+    }
+
+    /* Streams always go through the pipeline, the reader thread keeps pulling large chunks while the cipher works */
+    if (use_std) {
+        use_mmap = 0;
+        use_pipeline = 1;
+    }
+
+    fprintf(console, "Input: %s\n", strcmp(input_file, "-") == 0 ? "stdin" : input_file);
+    fprintf(console, "Output: %s\n", !output_file ? input_file : strcmp(output_file, "-") == 0 ? "stdout" : output_file);
+    if (use_mmap) fprintf(console, "I/O: memory mapped\n");
+    else if (use_pipeline && threads == 0) fprintf(console, "I/O: pipelined, one cipher thread per CPU\n");
+    else if (use_pipeline) fprintf(console, "I/O: pipelined, %u cipher thread(s)\n", threads);
+    if (!use_mmap) fprintf(console, "Buffer: %zu KB%s\n", buffer_size / 1024, use_direct ? ", direct I/O" : "");
+    fprintf(console, "Password: ********\n");
+    fprintf(console, "Nonce: 0x");
     for (int i = 0; i < 20; i++) {
-        printf("%02x", nonce[i]);
+        fprintf(console, "%02x", nonce[i]);
     }
-    printf("\n");
+    fprintf(console, "\n");
 
 /* Derive key from password */
     uint8_t key[32];
     derive_key_from_password(password, key);
 
-    /* Initialize IV buffer */
-    helix2_context_t ctx;
-    helix2_initialize_context(&ctx, key, nonce);
+    /* Initialize the keystream, processed sequentially from offset 0 */
+    helix2_stream_t stream;
+    helix2_stream_init(&stream, key, nonce, 0);
 
-    /* Open input and output files */
-    FILE *fin = fopen(input_file, "rb");
-    if (!fin) {
-        printf("Error: Cannot open input file '%s'\n", input_file);
-        return 1;
+    /* Mapped files where possible, pipes and other special files always go through buffered I/O */
+    uint64_t processed = 0;
+    int result;
+    if (use_mmap && is_regular_file(input_file)) {
+        result = process_mmap(&stream.schedule, input_file, output_file ? output_file : input_file, &processed);
+    } else if (use_pipeline) {
+        result = process_pipeline(&stream.schedule, input_file, output_file ? output_file : input_file, threads, buffer_size, use_direct, &processed);
+    } else {
+        if (use_mmap) fprintf(console, "Input is not a regular file, using buffered I/O\n");
+        result = process_buffered(&stream, input_file, output_file ? output_file : input_file, buffer_size, &processed);
     }
+    if (result != 0) return result;
+
+    fprintf(console, "\n\nDone, processed %" PRIu64 " bytes\n", processed);
+
+    return 0;
+}
 
-    FILE *fout = fopen(output_file ? output_file : input_file, "wb");
-    if (!fout) {
-        printf("Error: Cannot open output file '%s'\n", output_file ? output_file : input_file);
+/* Encrypt/decrypt through a stdio buffer, works for any kind of input
+   In place (the output is the input file) every chunk is written back over itself, nothing is truncated. */
+int process_buffered(helix2_stream_t *stream, const char *input_file, const char *output_file, size_t buffer_size, uint64_t *processed) {
+    FILE *fin, *fout;
+    uint64_t file_size;
+    if (open_files(input_file, output_file, &fin, &fout, &file_size) != 0) return 1;
+    int in_place = fin == fout;
+
+    uint8_t *buffer = buffer_alloc(buffer_size);
+    if (!buffer) {
+        fprintf(console, "Error: Cannot allocate I/O buffer\n");
         fclose(fin);
+        if (!in_place) fclose(fout);
         return 1;
     }
 
-    /* Get file size for progress tracking */
-    #ifdef _WIN32
-        _fseeki64(fin, 0, SEEK_END);
-        uint64_t file_size = (uint64_t)_ftelli64(fin);
-        _fseeki64(fin, 0, SEEK_SET);
-    #else
-        fseeko(fin, 0, SEEK_END);
-        uint64_t file_size = (uint64_t)ftello(fin);
-        fseeko(fin, 0, SEEK_SET);
-    #endif
-
     /* Process file with buffer */
-    uint8_t buffer[BUFFER_SIZE];
     size_t bytes_read;
     uint64_t file_offset = 0;
+    int error = 0;
 
-    while ((bytes_read = fread(buffer, 1, BUFFER_SIZE, fin)) > 0) {
-        helix2_buffer(&ctx, buffer, bytes_read, file_offset);
-        fwrite(buffer, 1, bytes_read, fout);
+    while ((bytes_read = fread(buffer, 1, buffer_size, fin)) > 0) {
+        helix2_stream_update(stream, buffer, bytes_read);
+        /* stdio wants a seek between reading and writing the same stream anyway */
+        if (in_place && seek_file(fout, (int64_t)file_offset) != 0) error = 1;
+        if (error || fwrite(buffer, 1, bytes_read, fout) != bytes_read) error = 1;
+        if (in_place && seek_file(fout, (int64_t)(file_offset + bytes_read)) != 0) error = 1;
+        if (error) break;
         file_offset += bytes_read;
 
         print_progress(file_offset, file_size);
     }
 
-    printf("\n\nDone, processed %" PRIu64 " bytes\n", file_offset);
-    
-    fclose(fin);
-    fclose(fout);
+    *processed = file_offset;
+
+    buffer_free(buffer);
+    if (!in_place) fclose(fin);
+    if (fclose(fout) != 0) error = 1;
+
+    if (error) {
+        fprintf(console, "\nError: Cannot write output file '%s'\n", output_file);
+        return 1;
+    }
+    return 0;
+}
+
+/* Decrypt (or encrypt) only length bytes at offset of the input, written to the start of the output
+   Every chunk is read with helix2_key_pread at its own file offset, which is also its keystream offset. */
+int process_range(const helix2_key_t *schedule, const char *input_file, const char *output_file, uint64_t offset, uint64_t length, size_t buffer_size, uint64_t *processed) {
+#ifdef _WIN32
+    int fd = _open(input_file, _O_RDONLY | _O_BINARY);
+    int64_t end = fd >= 0 ? _lseeki64(fd, 0, SEEK_END) : -1;
+#else
+    int fd = open(input_file, O_RDONLY);
+    int64_t end = fd >= 0 ? (int64_t)lseek(fd, 0, SEEK_END) : -1;
+#endif
+    if (fd < 0) {
+        fprintf(console, "Error: Cannot open input file '%s'\n", input_file);
+        return 1;
+    }
+
+    /* The range is clipped to the file, the progress needs its real size */
+    uint64_t total = 0;
+    if (end > 0 && (uint64_t)end > offset) total = (uint64_t)end - offset;
+    if (length < total) total = length;
+
+    /* The output is created from scratch, it cannot also be the input */
+    if (same_file(input_file, output_file)) {
+        fprintf(console, "Error: The output of --offset/--length must not be the input file\n");
+        close(fd);
+        return 1;
+    }
 
+    raw_file_t fout;
+    uint8_t *buffer = buffer_alloc(buffer_size);
+    if (!buffer || raw_open(&fout, output_file, RAW_OUTPUT, 0) != 0) {
+        fprintf(console, "Error: %s '%s'\n", buffer ? "Cannot open output file" : "Cannot allocate I/O buffer for", output_file);
+        if (buffer) buffer_free(buffer);
+        close(fd);
+        return 1;
+    }
+
+    int error = 0;
+    uint64_t done = 0;
+    while (done < total) {
+        size_t size = total - done < buffer_size ? (size_t)(total - done) : buffer_size;
+        int64_t count = helix2_key_pread(schedule, fd, buffer, size, offset + done);
+        if (count <= 0) {
+            error = count < 0;
+            break;
+        }
+        if (raw_write(&fout, buffer, (size_t)count, -1) != 0) {
+            error = 1;
+            break;
+        }
+        done += (uint64_t)count;
+
+        print_progress(done, total);
+    }
+    *processed = done;
+
+    buffer_free(buffer);
+    close(fd);
+    if (raw_close(&fout, 1, done) != 0) error = 1;
+
+    if (error) {
+        fprintf(console, "\nError: I/O failed on '%s' or '%s'\n", input_file, output_file);
+        return 1;
+    }
+    return 0;
+}
+
+/* Open input and output files, file_size (for progress tracking) is 0 for inputs that cannot seek
+   When both name the same file it is opened once for update and *fin == *fout. */
+int open_files(const char *input_file, const char *output_file, FILE **fin, FILE **fout, uint64_t *file_size) {
+    int in_place = same_file(input_file, output_file);
+    *fin = fopen(input_file, in_place ? "r+b" : "rb");
+    if (!*fin) {
+        fprintf(console, "Error: Cannot open input file '%s'\n", input_file);
+        return 1;
+    }
+
+    *fout = in_place ? *fin : fopen(output_file, "wb");
+    if (!*fout) {
+        fprintf(console, "Error: Cannot open output file '%s'\n", output_file);
+        fclose(*fin);
+        return 1;
+    }
+
+    #ifdef _WIN32
+        _fseeki64(*fin, 0, SEEK_END);
+        int64_t end = _ftelli64(*fin);
+    #else
+        fseeko(*fin, 0, SEEK_END);
+        int64_t end = (int64_t)ftello(*fin);
+    #endif
+    seek_file(*fin, 0);
+    *file_size = end > 0 ? (uint64_t)end : 0;
+
+    return 0;
+}
+
+/* Move a stdio stream to an absolute offset, returns 0 on success */
+int seek_file(FILE *file, int64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, offset, SEEK_SET);
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+/* Encrypt/decrypt with reads, keystream generation and writes overlapping on a ring of large buffers
+   Chunks are buffer_size bytes (page aligned, so a whole number of keystream blocks), threads > 1 (or 0 = one per CPU)
+   splits each chunk over several cipher threads, direct bypasses the page cache where the platform allows it. */
+int process_pipeline(const helix2_key_t *schedule, const char *input_file, const char *output_file, unsigned int threads, size_t buffer_size, int direct, uint64_t *processed) {
+    pipeline_t pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.buffer_size = buffer_size;
+    pipeline.in_place = same_file(input_file, output_file);
+
+    /* In place the chunk being written never overlaps the ones still to be read, one read/write handle is enough */
+    if (raw_open(&pipeline.fin, input_file, pipeline.in_place ? RAW_UPDATE : RAW_INPUT, direct) != 0) {
+        fprintf(console, "Error: Cannot open input file '%s'\n", input_file);
+        return 1;
+    }
+    if (pipeline.in_place) {
+        pipeline.fout = pipeline.fin;
+    } else if (raw_open(&pipeline.fout, output_file, RAW_OUTPUT, direct) != 0) {
+        fprintf(console, "Error: Cannot open output file '%s'\n", output_file);
+        raw_close(&pipeline.fin, 0, 0);
+        return 1;
+    }
+    if (direct && !(pipeline.fin.direct && pipeline.fout.direct)) {
+        fprintf(console, "Direct I/O not available for %s, using the page cache\n", pipeline.fin.direct ? "the output" : "the input");
+    }
+    uint64_t file_size = raw_size(&pipeline.fin);
+
+    for (int i = 0; i < PIPELINE_SLOTS; i++) {
+        pipeline.slots[i].data = buffer_alloc(buffer_size);
+        if (!pipeline.slots[i].data) {
+            fprintf(console, "Error: Cannot allocate I/O buffers\n");
+            for (int j = 0; j < i; j++) buffer_free(pipeline.slots[j].data);
+            raw_close(&pipeline.fin, 0, 0);
+            if (!pipeline.in_place) raw_close(&pipeline.fout, 1, 0);
+            return 1;
+        }
+    }
+
+    lock_init(&pipeline.lock);
+    cond_init(&pipeline.changed);
+
+    /* Without both threads every stage stops at once, as after an I/O error */
+    thread_t reader, writer;
+    int reader_started = thread_start(&reader, pipeline_reader, &pipeline) == 0;
+    int writer_started = reader_started && thread_start(&writer, pipeline_writer, &pipeline) == 0;
+    if (!writer_started) {
+        lock_acquire(&pipeline.lock);
+        pipeline.error = 1;
+        cond_notify(&pipeline.changed);
+        lock_release(&pipeline.lock);
+    }
+
+    helix2_parallel_t parallel = { threads, NULL, NULL };
+    uint64_t done = 0;
+
+    for (uint64_t chunk = 0; ; chunk++) {
+        pipeline_slot_t *slot = &pipeline.slots[chunk % PIPELINE_SLOTS];
+
+        lock_acquire(&pipeline.lock);
+        while (slot->state != SLOT_READ && !pipeline.error && !(pipeline.eof && chunk == pipeline.chunks)) {
+            cond_wait(&pipeline.changed, &pipeline.lock);
+        }
+        int finished = slot->state != SLOT_READ;
+        lock_release(&pipeline.lock);
+        if (finished) break;
+
+        if (threads == 1) helix2_key_buffer(schedule, slot->data, slot->length, slot->offset);
+        else helix2_key_buffer_parallel(schedule, slot->data, slot->length, slot->offset, &parallel);
+        done += slot->length;
+
+        lock_acquire(&pipeline.lock);
+        slot->state = SLOT_DONE;
+        cond_notify(&pipeline.changed);
+        lock_release(&pipeline.lock);
+
+        print_progress(done, file_size);
+    }
+
+    if (reader_started) thread_join(reader);
+    if (writer_started) thread_join(writer);
+
+    int error = pipeline.error;
+    *processed = done;
+
+    cond_destroy(&pipeline.changed);
+    lock_destroy(&pipeline.lock);
+    for (int i = 0; i < PIPELINE_SLOTS; i++) buffer_free(pipeline.slots[i].data);
+    if (!pipeline.in_place) raw_close(&pipeline.fin, 0, 0);
+    /* In place a direct file keeps its size even if a chunk failed half way */
+    if (raw_close(&pipeline.fout, 1, pipeline.in_place ? file_size : done) != 0) error = 1;
+
+    if (!writer_started) {
+        fprintf(console, "\nError: Cannot start the I/O threads\n");
+        return 1;
+    }
+    if (error) {
+        fprintf(console, "\nError: I/O failed on '%s' or '%s'\n", input_file, output_file);
+        return 1;
+    }
+    return 0;
+}
+
+/* Fill free slots in chunk order until the input ends */
+THREAD_RETURN pipeline_reader(void *arg) {
+    pipeline_t *pipeline = arg;
+    uint64_t offset = 0;
+
+    for (uint64_t chunk = 0; ; chunk++) {
+        pipeline_slot_t *slot = &pipeline->slots[chunk % PIPELINE_SLOTS];
+
+        lock_acquire(&pipeline->lock);
+        while (slot->state != SLOT_FREE && !pipeline->error) cond_wait(&pipeline->changed, &pipeline->lock);
+        int error = pipeline->error;
+        lock_release(&pipeline->lock);
+        if (error) break;
+
+        /* A short read only happens at the end of the input */
+        int64_t length = raw_read(&pipeline->fin, slot->data, pipeline->buffer_size, pipeline->in_place ? (int64_t)offset : -1);
+
+        lock_acquire(&pipeline->lock);
+        if (length < 0) pipeline->error = 1;
+        if (length > 0 && !pipeline->error) {
+            slot->length = (size_t)length;
+            slot->offset = offset;
+            slot->state = SLOT_READ;
+            pipeline->chunks++;
+            offset += (uint64_t)length;
+        }
+        if (length < (int64_t)pipeline->buffer_size || pipeline->error) pipeline->eof = 1;
+        int eof = pipeline->eof;
+        cond_notify(&pipeline->changed);
+        lock_release(&pipeline->lock);
+        if (eof) break;
+    }
+
+    return 0;
+}
+
+/* Write encrypted slots in chunk order and hand them back to the reader */
+THREAD_RETURN pipeline_writer(void *arg) {
+    pipeline_t *pipeline = arg;
+
+    for (uint64_t chunk = 0; ; chunk++) {
+        pipeline_slot_t *slot = &pipeline->slots[chunk % PIPELINE_SLOTS];
+
+        lock_acquire(&pipeline->lock);
+        while (slot->state != SLOT_DONE && !pipeline->error && !(pipeline->eof && chunk == pipeline->chunks)) {
+            cond_wait(&pipeline->changed, &pipeline->lock);
+        }
+        int finished = slot->state != SLOT_DONE;
+        lock_release(&pipeline->lock);
+        if (finished) break;
+
+        int failed = raw_write(&pipeline->fout, slot->data, slot->length, pipeline->in_place ? (int64_t)slot->offset : -1) != 0;
+
+        lock_acquire(&pipeline->lock);
+        if (failed) pipeline->error = 1;
+        slot->state = SLOT_FREE;
+        cond_notify(&pipeline->changed);
+        lock_release(&pipeline->lock);
+    }
+
+    return 0;
+}
+
+/* Write raw keystream from start (every stream with --sweep) to output_file, length bytes or until it is closed
+   threads workers generate buffer_size chunks over disjoint counter ranges, this thread writes them in order.
+   Stream s uses nonce + s, or key + s with sweep_key (little-endian counters over all the bytes). */
+int process_keystream(const uint8_t *key, const uint8_t *nonce, uint64_t streams, int sweep_key, const char *output_file, uint64_t start, uint64_t length, unsigned int threads, size_t buffer_size, uint64_t *processed) {
+    keystream_t keystream;
+    memset(&keystream, 0, sizeof(keystream));
+    keystream.streams = streams;
+    keystream.start = start;
+    keystream.length = length;
+    keystream.chunks = length == UINT64_MAX ? UINT64_MAX : (length + buffer_size - 1) / buffer_size;
+    keystream.buffer_size = buffer_size;
+
+    helix2_key_t *schedules = malloc((size_t)streams * sizeof(helix2_key_t));
+    pipeline_slot_t *slots = calloc(2 * (size_t)threads, sizeof(pipeline_slot_t));
+    keystream_worker_t *workers = calloc(threads, sizeof(keystream_worker_t));
+    thread_t *handles = calloc(threads, sizeof(thread_t));
+    int failed = !schedules || !slots || !workers || !handles;
+    for (size_t i = 0; !failed && i < 2 * (size_t)threads; i++) {
+        slots[i].data = buffer_alloc(buffer_size);
+        if (!slots[i].data) failed = 1;
+    }
+    if (failed) {
+        fprintf(console, "Error: Cannot allocate keystream buffers\n");
+    } else if (raw_open(&keystream.fout, output_file, RAW_OUTPUT, 0) != 0) {
+        fprintf(console, "Error: Cannot open output file '%s'\n", output_file);
+        failed = 1;
+    }
+    if (failed) {
+        for (size_t i = 0; slots && i < 2 * (size_t)threads; i++) if (slots[i].data) buffer_free(slots[i].data);
+        free(schedules);
+        free(slots);
+        free(workers);
+        free(handles);
+        return 1;
+    }
+
+    for (uint64_t s = 0; s < streams; s++) {
+        uint8_t stream_key[32], stream_nonce[20];
+        memcpy(stream_key, key, sizeof(stream_key));
+        memcpy(stream_nonce, nonce, sizeof(stream_nonce));
+        if (sweep_key) add_counter(stream_key, sizeof(stream_key), s);
+        else add_counter(stream_nonce, sizeof(stream_nonce), s);
+        helix2_initialize_key(&schedules[s], stream_key, stream_nonce);
+    }
+    keystream.schedules = schedules;
+    keystream.slots = slots;
+
+#ifndef _WIN32
+    /* A test suite that has read enough closes the pipe, that is the normal end of an endless run */
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    /* The workers wait for the lock to learn how many of them started, the chunks are shared out over those */
+    lock_init(&keystream.lock);
+    cond_init(&keystream.changed);
+    unsigned int started = 0;
+    lock_acquire(&keystream.lock);
+    for (; started < threads; started++) {
+        workers[started].keystream = &keystream;
+        workers[started].index = started;
+        if (thread_start(&handles[started], keystream_worker, &workers[started]) != 0) break;
+    }
+    keystream.workers = started;
+    lock_release(&keystream.lock);
+
+    uint64_t done = 0;
+    int error = started == 0;
+    for (uint64_t chunk = 0; !error && chunk < keystream.chunks; chunk++) {
+        pipeline_slot_t *slot = &slots[chunk % (2 * (uint64_t)started)];
+
+        lock_acquire(&keystream.lock);
+        while (slot->state != SLOT_DONE) cond_wait(&keystream.changed, &keystream.lock);
+        lock_release(&keystream.lock);
+
+        error = raw_write(&keystream.fout, slot->data, slot->length, -1) != 0;
+        if (!error) done += slot->length;
+
+        lock_acquire(&keystream.lock);
+        if (error) keystream.error = 1;
+        slot->state = SLOT_FREE;
+        cond_notify(&keystream.changed);
+        lock_release(&keystream.lock);
+        if (error) break;
+
+        print_progress(done, length == UINT64_MAX ? 0 : length);
+    }
+
+    for (unsigned int i = 0; i < started; i++) thread_join(handles[i]);
+    *processed = done;
+
+    cond_destroy(&keystream.changed);
+    lock_destroy(&keystream.lock);
+    for (size_t i = 0; i < 2 * (size_t)threads; i++) buffer_free(slots[i].data);
+    memset(schedules, 0, (size_t)streams * sizeof(helix2_key_t));
+    free(schedules);
+    free(slots);
+    free(workers);
+    free(handles);
+    if (raw_close(&keystream.fout, 1, done) != 0 && !error) error = 1;
+
+    if (started == 0) {
+        fprintf(console, "Error: Cannot start the keystream threads\n");
+        return 1;
+    }
+    /* Without --length the output closing is how the run ends */
+    if (error && length != UINT64_MAX) {
+        fprintf(console, "\nError: Writing '%s' failed\n", output_file);
+        return 1;
+    }
     return 0;
 }
 
+/* Generate this worker's chunks (index, index + workers, ...), each into its own two slots */
+THREAD_RETURN keystream_worker(void *arg) {
+    keystream_worker_t *worker = arg;
+    keystream_t *keystream = worker->keystream;
+
+    lock_acquire(&keystream->lock);
+    uint64_t workers = keystream->workers;
+    lock_release(&keystream->lock);
+    uint64_t slot_count = 2 * workers;
+
+    for (uint64_t chunk = worker->index; chunk < keystream->chunks; chunk += workers) {
+        pipeline_slot_t *slot = &keystream->slots[chunk % slot_count];
+
+        lock_acquire(&keystream->lock);
+        while (slot->state != SLOT_FREE && !keystream->error) cond_wait(&keystream->changed, &keystream->lock);
+        int error = keystream->error;
+        lock_release(&keystream->lock);
+        if (error) break;
+
+        size_t size = keystream->buffer_size;
+        if (keystream->length != UINT64_MAX && keystream->length - chunk * size < size) size = (size_t)(keystream->length - chunk * size);
+        uint64_t offset = keystream->start + chunk / keystream->streams * keystream->buffer_size;
+        helix2_key_keystream(&keystream->schedules[chunk % keystream->streams], slot->data, size, offset);
+
+        lock_acquire(&keystream->lock);
+        slot->length = size;
+        slot->state = SLOT_DONE;
+        cond_notify(&keystream->changed);
+        lock_release(&keystream->lock);
+    }
+
+    return 0;
+}
+
+/* Add value to a little-endian number of size bytes, wrapping around */
+void add_counter(uint8_t *bytes, size_t size, uint64_t value) {
+    unsigned int carry = 0;
+    for (size_t i = 0; i < size; i++) {
+        unsigned int sum = bytes[i] + (unsigned int)(value & 0xFF) + carry;
+        bytes[i] = (uint8_t)sum;
+        carry = sum >> 8;
+        value >>= 8;
+    }
+}
+
+/* Parse a byte count with an optional K, M or G suffix, returns 0 on success */
+int parse_count(const char *s, uint64_t *count) {
+    char *end;
+    if (!isdigit((unsigned char)*s)) return 1;
+    unsigned long long value = strtoull(s, &end, 10);
+
+    switch (toupper((unsigned char)*end)) {
+        case 'K': value *= 1024; end++; break;
+        case 'M': value *= 1024 * 1024; end++; break;
+        case 'G': value *= 1024 * 1024 * 1024; end++; break;
+        default: break;
+    }
+    if (*end != '\0') return 1;
+
+    *count = (uint64_t)value;
+    return 0;
+}
+
+/* Parse a buffer size, rounded up to BUFFER_ALIGN, 0 if invalid */
+size_t parse_size(const char *s) {
+    uint64_t size;
+    if (parse_count(s, &size) != 0 || size == 0 || size > BUFFER_MAX) return 0;
+
+    size = (size + BUFFER_ALIGN - 1) / BUFFER_ALIGN * BUFFER_ALIGN;
+    return (size_t)size;
+}
+
+/* Page aligned buffers, size must be a multiple of BUFFER_ALIGN */
+void *buffer_alloc(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, BUFFER_ALIGN);
+#else
+    void *buffer;
+    return posix_memalign(&buffer, BUFFER_ALIGN, size) == 0 ? buffer : NULL;
+#endif
+}
+
+void buffer_free(void *buffer) {
+#ifdef _WIN32
+    _aligned_free(buffer);
+#else
+    free(buffer);
+#endif
+}
+
+/* Open a file for the pipeline, RAW_INPUT read-only, RAW_OUTPUT created/truncated or RAW_UPDATE read/write
+   (never truncated), - is stdin or stdout. Direct I/O is requested when asked for and silently dropped where the
+   file (e.g. a pipe) does not support it, file->direct tells which one it got. Returns 0 on success. */
+int raw_open(raw_file_t *file, const char *filename, int mode, int direct) {
+#ifdef _WIN32
+    if (strcmp(filename, "-") == 0) {
+        file->direct = 0;
+        file->handle = GetStdHandle(mode == RAW_OUTPUT ? STD_OUTPUT_HANDLE : STD_INPUT_HANDLE);
+        return file->handle == INVALID_HANDLE_VALUE || file->handle == NULL;
+    }
+    DWORD access = mode == RAW_OUTPUT ? GENERIC_WRITE : mode == RAW_UPDATE ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+    DWORD creation = mode == RAW_OUTPUT ? CREATE_ALWAYS : OPEN_EXISTING;
+    file->direct = 0;
+    if (direct) {
+        file->handle = CreateFileA(filename, access, FILE_SHARE_READ, NULL, creation, FILE_FLAG_NO_BUFFERING, NULL);
+        if (file->handle != INVALID_HANDLE_VALUE) {
+            file->direct = 1;
+            return 0;
+        }
+    }
+    file->handle = CreateFileA(filename, access, FILE_SHARE_READ, NULL, creation, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    return file->handle == INVALID_HANDLE_VALUE;
+#else
+    int flags = mode == RAW_OUTPUT ? O_WRONLY | O_CREAT | O_TRUNC : mode == RAW_UPDATE ? O_RDWR : O_RDONLY;
+    file->direct = 0;
+    if (strcmp(filename, "-") == 0) {
+        file->fd = mode == RAW_OUTPUT ? STDOUT_FILENO : STDIN_FILENO;
+#if defined(F_SETPIPE_SZ)
+        struct stat st;
+        if (fstat(file->fd, &st) == 0 && S_ISFIFO(st.st_mode)) fcntl(file->fd, F_SETPIPE_SZ, PIPE_SIZE);
+#endif
+        return 0;
+    }
+#if defined(O_DIRECT)
+    if (direct) {
+        file->fd = open(filename, flags | O_DIRECT, 0644);
+        if (file->fd >= 0) {
+            file->direct = 1;
+            return 0;
+        }
+    }
+#endif
+    file->fd = open(filename, flags, 0644);
+    if (file->fd < 0) return 1;
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+    if (direct) file->direct = fcntl(file->fd, F_NOCACHE, 1) == 0;
+#endif
+    return 0;
+#endif
+}
+
+/* Read until size bytes or the end of the input, at the current position or (offset >= 0) at offset
+   Returns the bytes read or -1 on error. A non-blocking descriptor (stdin can be one, inherited from the parent)
+   is waited on instead of failing. */
+int64_t raw_read(raw_file_t *file, uint8_t *buffer, size_t size, int64_t offset) {
+    size_t total = 0;
+    while (total < size) {
+#ifdef _WIN32
+        DWORD request = size - total > 0x40000000 ? 0x40000000 : (DWORD)(size - total);
+        DWORD count;
+        OVERLAPPED at;
+        raw_position(&at, offset, total);
+        if (!ReadFile(file->handle, &buffer[total], request, &count, offset >= 0 ? &at : NULL)) {
+            if (GetLastError() == ERROR_BROKEN_PIPE || GetLastError() == ERROR_HANDLE_EOF) break;
+            return -1;
+        }
+#else
+        ssize_t count = offset >= 0 ? pread(file->fd, &buffer[total], size - total, (off_t)(offset + (int64_t)total))
+                                    : read(file->fd, &buffer[total], size - total);
+        if (count < 0 && raw_wait(file, POLLIN)) continue;
+        if (count < 0) return -1;
+#endif
+        if (count == 0) break;
+        total += (size_t)count;
+    }
+    return (int64_t)total;
+}
+
+/* Write size bytes at the current position or (offset >= 0) at offset
+   Direct files get the last partial chunk padded to BUFFER_ALIGN and trimmed again in raw_close. */
+int raw_write(raw_file_t *file, const uint8_t *buffer, size_t size, int64_t offset) {
+    if (file->direct) size = (size + BUFFER_ALIGN - 1) / BUFFER_ALIGN * BUFFER_ALIGN;
+
+    size_t total = 0;
+    while (total < size) {
+#ifdef _WIN32
+        DWORD request = size - total > 0x40000000 ? 0x40000000 : (DWORD)(size - total);
+        DWORD count;
+        OVERLAPPED at;
+        raw_position(&at, offset, total);
+        if (!WriteFile(file->handle, &buffer[total], request, &count, offset >= 0 ? &at : NULL)) return 1;
+#else
+        ssize_t count = offset >= 0 ? pwrite(file->fd, &buffer[total], size - total, (off_t)(offset + (int64_t)total))
+                                    : write(file->fd, &buffer[total], size - total);
+        if (count < 0 && raw_wait(file, POLLOUT)) continue;
+        if (count <= 0) return 1;
+#endif
+        total += (size_t)count;
+    }
+    return 0;
+}
+
+#ifdef _WIN32
+/* Positioned ReadFile/WriteFile on a synchronous handle, offset + done bytes from the start */
+void raw_position(OVERLAPPED *at, int64_t offset, size_t done) {
+    uint64_t position = (uint64_t)offset + done;
+    memset(at, 0, sizeof(*at));
+    at->Offset = (DWORD)position;
+    at->OffsetHigh = (DWORD)(position >> 32);
+}
+#else
+/* After a failed read or write, 1 if it is worth retrying: interrupted, or a non-blocking descriptor that is now ready */
+int raw_wait(raw_file_t *file, short events) {
+    if (errno == EINTR) return 1;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+
+    struct pollfd ready = { file->fd, events, 0 };
+    return poll(&ready, 1, -1) >= 0 || errno == EINTR;
+}
+#endif
+
+/* Close a pipeline file, a direct output is cut back to final_size bytes */
+int raw_close(raw_file_t *file, int output, uint64_t final_size) {
+    int result = 0;
+#ifdef _WIN32
+    if (output && file->direct) {
+        LARGE_INTEGER size;
+        size.QuadPart = (LONGLONG)final_size;
+        if (!SetFilePointerEx(file->handle, size, NULL, FILE_BEGIN) || !SetEndOfFile(file->handle)) result = 1;
+    }
+    if (!CloseHandle(file->handle)) result = 1;
+#else
+    if (output && file->direct && ftruncate(file->fd, (off_t)final_size) != 0) result = 1;
+    if (close(file->fd) != 0) result = 1;
+#endif
+    return result;
+}
+
+/* Size of a regular input file for progress tracking, 0 for pipes */
+uint64_t raw_size(raw_file_t *file) {
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    if (GetFileType(file->handle) != FILE_TYPE_DISK || !GetFileSizeEx(file->handle, &size)) return 0;
+    return (uint64_t)size.QuadPart;
+#else
+    struct stat st;
+    if (fstat(file->fd, &st) != 0 || !S_ISREG(st.st_mode)) return 0;
+    return (uint64_t)st.st_size;
+#endif
+}
+
+/* Encrypt/decrypt every file of the inputs (files, and directories walked recursively) on a pool of threads
+   Files are processed like -m, in place without output_dir, otherwise into output_dir/relative path. */
+int process_batch(const helix2_key_t *schedule, const uint8_t *nonce, const char **inputs, size_t input_count, const char *output_dir, unsigned int threads) {
+    batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.schedule = schedule;
+    batch.nonce = nonce;
+    batch.output_dir = output_dir;
+
+    /* Names start with the input's own name, so d1/f and d2/f stay apart (. and .. add no name) */
+    for (size_t i = 0; i < input_count; i++) {
+        char *name = path_name(inputs[i]);
+        int result;
+        if (is_directory(inputs[i])) {
+            result = batch_scan(&batch, inputs[i], name);
+        } else {
+            result = batch_add(&batch, inputs[i], name ? name : inputs[i]);
+        }
+        free(name);
+        if (result != 0) {
+            fprintf(console, "Error: Cannot read input '%s'\n", inputs[i]);
+            batch.failed++;
+        }
+    }
+
+    /* Two files with one name would share a nonce (keystream reuse) and, with -o, one output file */
+    size_t duplicates = 0;
+    if (batch.count > 1) qsort(batch.files, batch.count, sizeof(batch_file_t), batch_compare);
+    for (size_t i = 1; i < batch.count; i++) {
+        if (batch_compare(&batch.files[i - 1], &batch.files[i]) == 0) {
+            fprintf(console, "Error: '%s' and '%s' have the same name '%s' in the batch\n", batch.files[i - 1].path, batch.files[i].path, batch.files[i].relative);
+            duplicates++;
+        }
+    }
+    if (duplicates > 0) {
+        fprintf(console, "Nothing processed, give such inputs in separate runs\n");
+        for (size_t i = 0; i < batch.count; i++) {
+            free(batch.files[i].path);
+            free(batch.files[i].relative);
+        }
+        free(batch.files);
+        return 1;
+    }
+
+    if (threads == 0) threads = cpu_count();
+    if (threads > batch.count) threads = batch.count > 0 ? (unsigned int)batch.count : 1;
+    fprintf(console, "Files: %zu, %u worker thread(s)\n", batch.count, threads);
+
+    show_progress = 0;
+    lock_init(&batch.lock);
+    double start = seconds_now();
+
+    thread_t *workers = calloc(threads, sizeof(thread_t));
+    unsigned int started = 0;
+    for (; workers && started < threads; started++) {
+        if (thread_start(&workers[started], batch_worker, &batch) != 0) break;
+    }
+    if (started == 0) batch_worker(&batch);
+    for (unsigned int i = 0; i < started; i++) thread_join(workers[i]);
+
+    double seconds = seconds_now() - start;
+    lock_destroy(&batch.lock);
+    free(workers);
+    show_progress = 1;
+
+    double megabytes = (double)batch.bytes / (1024.0 * 1024.0);
+    fprintf(console, "\n\nDone, processed %zu file(s), %" PRIu64 " bytes in %.2f s", batch.done, batch.bytes, seconds);
+    if (seconds > 0) fprintf(console, " (%.2f MB/s)", megabytes / seconds);
+    fprintf(console, "\n");
+    if (batch.failed > 0) fprintf(console, "Failed: %zu file(s)\n", batch.failed);
+
+    for (size_t i = 0; i < batch.count; i++) {
+        free(batch.files[i].path);
+        free(batch.files[i].relative);
+    }
+    free(batch.files);
+
+    return batch.failed > 0;
+}
+
+/* Claim files one at a time, each under its own nonce */
+THREAD_RETURN batch_worker(void *arg) {
+    batch_t *batch = arg;
+
+    for (;;) {
+        lock_acquire(&batch->lock);
+        size_t index = batch->next;
+        if (index < batch->count) batch->next++;
+        lock_release(&batch->lock);
+        if (index >= batch->count) break;
+
+        batch_file_t *file = &batch->files[index];
+        helix2_key_t schedule = *batch->schedule;
+        uint8_t nonce[20];
+        derive_file_nonce(batch->nonce, file->relative, nonce);
+        helix2_key_set_nonce(&schedule, nonce);
+
+        char *output = batch->output_dir ? join_path(batch->output_dir, file->relative) : NULL;
+        uint64_t processed = 0;
+        int result = 1;
+        if (!batch->output_dir || (output && make_parent_dirs(output) == 0)) {
+            result = process_mmap(&schedule, file->path, output ? output : file->path, &processed);
+        }
+        free(output);
+
+        lock_acquire(&batch->lock);
+        batch->done++;
+        if (result != 0) batch->failed++;
+        batch->bytes += processed;
+        draw_progress(batch->done, batch->count);
+        lock_release(&batch->lock);
+    }
+
+    return 0;
+}
+
+int batch_add(batch_t *batch, const char *path, const char *relative) {
+    if (batch->count == batch->capacity) {
+        size_t capacity = batch->capacity ? batch->capacity * 2 : 256;
+        batch_file_t *files = realloc(batch->files, capacity * sizeof(batch_file_t));
+        if (!files) return 1;
+        batch->files = files;
+        batch->capacity = capacity;
+    }
+
+    batch_file_t *file = &batch->files[batch->count];
+    file->path = malloc(strlen(path) + 1);
+    file->relative = malloc(strlen(relative) + 1);
+    if (!file->path || !file->relative) {
+        free(file->path);
+        free(file->relative);
+        return 1;
+    }
+    strcpy(file->path, path);
+    strcpy(file->relative, relative);
+    batch->count++;
+    return 0;
+}
+
+/* Add the regular files below a directory, relative paths use '/' on every platform */
+int batch_scan(batch_t *batch, const char *directory, const char *relative) {
+    int result = 0;
+
+#ifdef _WIN32
+    char *pattern = join_path(directory, "*");
+    WIN32_FIND_DATAA entry;
+    HANDLE find = pattern ? FindFirstFileA(pattern, &entry) : INVALID_HANDLE_VALUE;
+    free(pattern);
+    if (find == INVALID_HANDLE_VALUE) return 1;
+
+    do {
+        const char *name = entry.cFileName;
+#else
+    DIR *dir = opendir(directory);
+    if (!dir) return 1;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+#endif
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+
+        char *path = join_path(directory, name);
+        char *child = relative ? malloc(strlen(relative) + strlen(name) + 2) : NULL;
+        if (child) sprintf(child, "%s/%s", relative, name);
+        const char *child_relative = relative ? child : name;
+
+        if (!path || (relative && !child)) {
+            result = 1;
+        } else if (is_directory(path)) {
+            if (batch_scan(batch, path, child_relative) != 0) result = 1;
+        } else if (is_regular_file(path)) {
+            if (batch_add(batch, path, child_relative) != 0) result = 1;
+        }
+        free(path);
+        free(child);
+#ifdef _WIN32
+    } while (FindNextFileA(find, &entry));
+    FindClose(find);
+#else
+    }
+    closedir(dir);
+#endif
+
+    return result;
+}
+
+/* Order of batch names, the same on every platform for the same names (Windows file names ignore case) */
+int batch_compare(const void *a, const void *b) {
+    const char *x = ((const batch_file_t *)a)->relative;
+    const char *y = ((const batch_file_t *)b)->relative;
+#ifdef _WIN32
+    return _stricmp(x, y);
+#else
+    return strcmp(x, y);
+#endif
+}
+
+/* Per-file nonce of batch mode, the base nonce XORed with a splitmix64 expansion of a 64-bit FNV-1a hash
+   of the file's batch name, so a file decrypts with the same nonce wherever the tree is stored.
+   A single file of a batch decrypts on its own with --name and that batch name. */
+void derive_file_nonce(const uint8_t *base, const char *relative, uint8_t *nonce) {
+    uint64_t state = 0xCBF29CE484222325ull;
+    for (const char *c = relative; *c; c++) {
+        state ^= (uint8_t)(*c == '\\' ? '/' : *c);
+        state *= 0x100000001B3ull;
+    }
+
+    uint64_t z = 0;
+    for (int i = 0; i < 20; i++) {
+        if (i % 8 == 0) {
+            state += 0x9E3779B97F4A7C15ull;
+            z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z = z ^ (z >> 31);
+        }
+        nonce[i] = base[i] ^ (uint8_t)(z >> ((i % 8) * 8));
+    }
+}
+
+/* Last component of a path without trailing separators (a copy), NULL for ., .. and roots */
+char *path_name(const char *path) {
+    size_t end = strlen(path);
+    while (end > 0 && (path[end - 1] == '/' || path[end - 1] == PATH_SEPARATOR)) end--;
+    size_t begin = end;
+    while (begin > 0 && path[begin - 1] != '/' && path[begin - 1] != PATH_SEPARATOR && !(PATH_SEPARATOR == '\\' && path[begin - 1] == ':')) begin--;
+
+    size_t length = end - begin;
+    if (length == 0 || (length == 1 && path[begin] == '.') || (length == 2 && path[begin] == '.' && path[begin + 1] == '.')) return NULL;
+
+    char *name = malloc(length + 1);
+    if (!name) return NULL;
+    memcpy(name, &path[begin], length);
+    name[length] = '\0';
+    return name;
+}
+
+/* dir + separator + name in a new allocation */
+char *join_path(const char *dir, const char *name) {
+    size_t length = strlen(dir);
+    char *path = malloc(length + strlen(name) + 2);
+    if (!path) return NULL;
+
+    strcpy(path, dir);
+    if (length > 0 && path[length - 1] != '/' && path[length - 1] != PATH_SEPARATOR) path[length++] = PATH_SEPARATOR;
+    strcpy(&path[length], name);
+    return path;
+}
+
+/* Create the missing directories of a file path */
+int make_parent_dirs(const char *path) {
+    char *copy = malloc(strlen(path) + 1);
+    if (!copy) return 1;
+    strcpy(copy, path);
+
+    for (char *c = copy + 1; *c; c++) {
+        if (*c != '/' && *c != PATH_SEPARATOR) continue;
+        char separator = *c;
+        *c = '\0';
+#ifdef _WIN32
+        if (!CreateDirectoryA(copy, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+#else
+        if (mkdir(copy, 0755) != 0 && !is_directory(copy)) {
+#endif
+            free(copy);
+            return 1;
+        }
+        *c = separator;
+    }
+
+    free(copy);
+    return 0;
+}
+
+int is_directory(const char *path) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+/* Monotonic wall clock for throughput reports */
+double seconds_now(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+}
+
+unsigned int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+#endif
+}
+
+/* Start a thread, returns 0 on success */
+int thread_start(thread_t *thread, thread_fn fn, void *arg) {
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, fn, arg, 0, NULL);
+    return *thread == NULL;
+#else
+    return pthread_create(thread, NULL, fn, arg) != 0;
+#endif
+}
+
+/* Wait for a thread started by thread_start and release it */
+void thread_join(thread_t thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+/* Encrypt/decrypt a memory mapped file, in place when input and output are the same file */
+int process_mmap(const helix2_key_t *schedule, const char *input_file, const char *output_file, uint64_t *processed) {
+    mapped_file_t in, out;
+    int in_place = same_file(input_file, output_file);
+
+    if (map_file(&in, input_file, in_place, 0, 0) != 0) {
+        fprintf(console, "Error: Cannot map input file '%s'\n", input_file);
+        return 1;
+    }
+
+    if (!in_place && map_file(&out, output_file, 1, 1, in.size) != 0) {
+        fprintf(console, "Error: Cannot map output file '%s'\n", output_file);
+        unmap_file(&in);
+        return 1;
+    }
+
+    uint8_t *dst = in_place ? in.data : out.data;
+    uint64_t offset = 0;
+
+    while (offset < in.size) {
+        size_t chunk = in.size - offset < MMAP_CHUNK ? (size_t)(in.size - offset) : MMAP_CHUNK;
+        helix2_key_buffer_copy(schedule, &dst[offset], &in.data[offset], chunk, offset);
+        offset += chunk;
+
+        print_progress(offset, in.size);
+    }
+
+    *processed = offset;
+
+    if (!in_place) unmap_file(&out);
+    unmap_file(&in);
+
+    return 0;
+}
+
+/* 1 if both names refer to the same existing file (also through links or different paths), - never does */
+int same_file(const char *a, const char *b) {
+    if (strcmp(a, "-") == 0 || strcmp(b, "-") == 0) return 0;
+    if (strcmp(a, b) == 0) return 1;
+#ifdef _WIN32
+    BY_HANDLE_FILE_INFORMATION info[2];
+    const char *names[2] = { a, b };
+    for (int i = 0; i < 2; i++) {
+        HANDLE handle = CreateFileA(names[i], 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+        if (handle == INVALID_HANDLE_VALUE) return 0;
+        BOOL ok = GetFileInformationByHandle(handle, &info[i]);
+        CloseHandle(handle);
+        if (!ok) return 0;
+    }
+    return info[0].dwVolumeSerialNumber == info[1].dwVolumeSerialNumber &&
+           info[0].nFileIndexHigh == info[1].nFileIndexHigh && info[0].nFileIndexLow == info[1].nFileIndexLow;
+#else
+    struct stat sa, sb;
+    if (stat(a, &sa) != 0 || stat(b, &sb) != 0) return 0;
+    return sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+#endif
+}
+
+/* Only regular files can be mapped, pipes and devices use buffered I/O */
+int is_regular_file(const char *filename) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(filename);
+    return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_DEVICE));
+#else
+    struct stat st;
+    return stat(filename, &st) == 0 && S_ISREG(st.st_mode);
+#endif
+}
+
+/* Map a whole file, read-only or shared writable, create makes a new file of create_size bytes
+   Empty files are not mapped (data is NULL), returns 0 on success. */
+int map_file(mapped_file_t *map, const char *filename, int writable, int create, uint64_t create_size) {
+    memset(map, 0, sizeof(*map));
+
+#ifdef _WIN32
+    map->file = CreateFileA(filename, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, NULL,
+                            create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (map->file == INVALID_HANDLE_VALUE) return 1;
+
+    if (create) {
+        map->size = create_size;
+    } else {
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(map->file, &size)) {
+            CloseHandle(map->file);
+            return 1;
+        }
+        map->size = (uint64_t)size.QuadPart;
+    }
+    if (map->size == 0) return 0;
+
+    /* Mapping a new file with a size extends it to that size */
+    map->mapping = CreateFileMappingA(map->file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                      (DWORD)(map->size >> 32), (DWORD)(map->size & 0xFFFFFFFF), NULL);
+    if (!map->mapping) {
+        CloseHandle(map->file);
+        return 1;
+    }
+
+    map->data = MapViewOfFile(map->mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    if (!map->data) {
+        CloseHandle(map->mapping);
+        CloseHandle(map->file);
+        return 1;
+    }
+#else
+    map->fd = open(filename, create ? O_RDWR | O_CREAT | O_TRUNC : (writable ? O_RDWR : O_RDONLY), 0644);
+    if (map->fd < 0) return 1;
+
+    if (create) {
+        if (ftruncate(map->fd, (off_t)create_size) != 0) {
+            close(map->fd);
+            return 1;
+        }
+        map->size = create_size;
+    } else {
+        struct stat st;
+        if (fstat(map->fd, &st) != 0) {
+            close(map->fd);
+            return 1;
+        }
+        map->size = (uint64_t)st.st_size;
+    }
+    if (map->size == 0) return 0;
+
+    if ((uint64_t)(size_t)map->size != map->size) {
+        close(map->fd);
+        return 1;
+    }
+
+    void *data = mmap(NULL, (size_t)map->size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, map->fd, 0);
+    if (data == MAP_FAILED) {
+        close(map->fd);
+        return 1;
+    }
+    map->data = data;
+
+    /* Every byte is touched exactly once, front to back */
+    posix_madvise(map->data, (size_t)map->size, POSIX_MADV_SEQUENTIAL);
+#endif
+
+    return 0;
+}
+
+void unmap_file(mapped_file_t *map) {
+#ifdef _WIN32
+    if (map->data) {
+        FlushViewOfFile(map->data, 0);
+        UnmapViewOfFile(map->data);
+    }
+    if (map->mapping) CloseHandle(map->mapping);
+    CloseHandle(map->file);
+#else
+    if (map->data) munmap(map->data, (size_t)map->size);
+    close(map->fd);
+#endif
+}
+
 void syntax() {
     printf("Crypt Command Line Utility\n");
     printf("Usage: crypt_cl options filename\n");
     printf("Options:\n");
     printf("  -e            Encrypt the file\n");   
     printf("  -d            Decrypt the file\n");
+    printf("  -k            Write the raw keystream (no input file) to -o or stdout, for statistical test suites\n");
     printf("  -p <password> Specify the encryption password\n");
     printf("  -n <nonce>    Specify the seed value (40 hex chars = 20 bytes), ex. 0123456789abcdef0123456789abcdef01234567\n");
-    printf("  -o <output>   Specify the output filename, if ommited then the input files will be processed\n");
+    printf("  -o <output>   Specify the output filename, if ommited then the input files will be processed in place\n");
+    printf("  -m            Memory map the files instead of buffered I/O (regular files only)\n");
+    printf("  -t <threads>  Pipelined I/O, reads and writes overlap with <threads> cipher threads (0 = one per CPU)\n");
+    printf("  -b <size>     I/O buffer size, ex. 512K, 16M (default 4M, rounded up to 4K)\n");
+    printf("  -D            Direct I/O (O_DIRECT / no buffering), bypasses the page cache, implies pipelined I/O\n");
+    printf("  --offset <n>  Only process the input from byte <n> (K/M/G suffix allowed), written to -o or stdout\n");
+    printf("  --length <n>  Only process <n> bytes of the input, from --offset or the start\n");
+    printf("  --name <name> Use the nonce batch mode gives the file <name> (ex. dataset/notes.txt), for one file of a batch\n");
+    printf("  --sweep <n>   With -k, interleave <n> streams (nonce + 0..n-1) one buffer at a time\n");
+    printf("  --sweep-key   With --sweep, step the key instead of the nonce\n");
     printf("  -h            Show this help message\n");
+    printf("A filename of - reads stdin, -o - writes stdout (the default for stdin), messages then go to stderr.\n");
+    printf("Several input files or a directory (recursive) are processed in batch mode: the key is derived once,\n");
+    printf("-t sets the number of files processed at the same time (default one per CPU), -o names an output directory\n");
+    printf("and every file's nonce is the -n nonce mixed with its batch name: the input argument's name and the path below\n");
+    printf("it (d1/sub/x for d1/sub/x under the argument d1, x for a file x given directly), mirrored below -o. Names must be\n");
+    printf("unique in a batch. A batch file decrypted on its own needs the same nonce: --name <batch name>.\n");
+    printf("-k generates on -t threads (default one per CPU) until the output is closed, --offset sets the keystream\n");
+    printf("offset it starts from and --length the number of bytes to write.\n");
 }
\ No newline at end of file